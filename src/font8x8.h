@@ -2,6 +2,10 @@
  * This is a simple 8x8 font to use within the sprite editor.
  * 
  * Adapted from: https://github.com/idispatch/raster-fonts/blob/master/font-8x8.c
+ *
+ * This is the editable source and covers ASCII 32 to 127 inclusive. The editor
+ * does not include it directly, it uses the compressed font8x8z.h generated from
+ * this file by tools/fontpack which also derives the rest of the 256 codes.
 */
 unsigned char console_font_8x8[] = {
     /*
@@ -771,4 +775,388 @@ unsigned char console_font_8x8[] = {
     0x00,  /* 00000000 */
     0x00,  /* 00000000 */
     0xFF,  /* 11111111 */
+
+    /*
+     * code=96, hex=0x60, ascii="`"
+     */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x0C,  /* 00001100 */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=97, hex=0x61, ascii="a"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x78,  /* 01111000 */
+    0x0C,  /* 00001100 */
+    0x7C,  /* 01111100 */
+    0xCC,  /* 11001100 */
+    0x76,  /* 01110110 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=98, hex=0x62, ascii="b"
+     */
+    0xE0,  /* 11100000 */
+    0x60,  /* 01100000 */
+    0x7C,  /* 01111100 */
+    0x66,  /* 01100110 */
+    0x66,  /* 01100110 */
+    0x66,  /* 01100110 */
+    0xDC,  /* 11011100 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=99, hex=0x63, ascii="c"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x7C,  /* 01111100 */
+    0xC6,  /* 11000110 */
+    0xC0,  /* 11000000 */
+    0xC6,  /* 11000110 */
+    0x7C,  /* 01111100 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=100, hex=0x64, ascii="d"
+     */
+    0x1C,  /* 00011100 */
+    0x0C,  /* 00001100 */
+    0x7C,  /* 01111100 */
+    0xCC,  /* 11001100 */
+    0xCC,  /* 11001100 */
+    0xCC,  /* 11001100 */
+    0x76,  /* 01110110 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=101, hex=0x65, ascii="e"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x7C,  /* 01111100 */
+    0xC6,  /* 11000110 */
+    0xFE,  /* 11111110 */
+    0xC0,  /* 11000000 */
+    0x7C,  /* 01111100 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=102, hex=0x66, ascii="f"
+     */
+    0x3C,  /* 00111100 */
+    0x66,  /* 01100110 */
+    0x60,  /* 01100000 */
+    0xF8,  /* 11111000 */
+    0x60,  /* 01100000 */
+    0x60,  /* 01100000 */
+    0xF0,  /* 11110000 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=103, hex=0x67, ascii="g"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x76,  /* 01110110 */
+    0xCC,  /* 11001100 */
+    0xCC,  /* 11001100 */
+    0x7C,  /* 01111100 */
+    0x0C,  /* 00001100 */
+    0xF8,  /* 11111000 */
+
+    /*
+     * code=104, hex=0x68, ascii="h"
+     */
+    0xE0,  /* 11100000 */
+    0x60,  /* 01100000 */
+    0x6C,  /* 01101100 */
+    0x76,  /* 01110110 */
+    0x66,  /* 01100110 */
+    0x66,  /* 01100110 */
+    0xE6,  /* 11100110 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=105, hex=0x69, ascii="i"
+     */
+    0x18,  /* 00011000 */
+    0x00,  /* 00000000 */
+    0x38,  /* 00111000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x3C,  /* 00111100 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=106, hex=0x6A, ascii="j"
+     */
+    0x06,  /* 00000110 */
+    0x00,  /* 00000000 */
+    0x06,  /* 00000110 */
+    0x06,  /* 00000110 */
+    0x06,  /* 00000110 */
+    0x66,  /* 01100110 */
+    0x66,  /* 01100110 */
+    0x3C,  /* 00111100 */
+
+    /*
+     * code=107, hex=0x6B, ascii="k"
+     */
+    0xE0,  /* 11100000 */
+    0x60,  /* 01100000 */
+    0x66,  /* 01100110 */
+    0x6C,  /* 01101100 */
+    0x78,  /* 01111000 */
+    0x6C,  /* 01101100 */
+    0xE6,  /* 11100110 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=108, hex=0x6C, ascii="l"
+     */
+    0x38,  /* 00111000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x3C,  /* 00111100 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=109, hex=0x6D, ascii="m"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0xEC,  /* 11101100 */
+    0xFE,  /* 11111110 */
+    0xD6,  /* 11010110 */
+    0xD6,  /* 11010110 */
+    0xD6,  /* 11010110 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=110, hex=0x6E, ascii="n"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0xDC,  /* 11011100 */
+    0x66,  /* 01100110 */
+    0x66,  /* 01100110 */
+    0x66,  /* 01100110 */
+    0x66,  /* 01100110 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=111, hex=0x6F, ascii="o"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x7C,  /* 01111100 */
+    0xC6,  /* 11000110 */
+    0xC6,  /* 11000110 */
+    0xC6,  /* 11000110 */
+    0x7C,  /* 01111100 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=112, hex=0x70, ascii="p"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0xDC,  /* 11011100 */
+    0x66,  /* 01100110 */
+    0x66,  /* 01100110 */
+    0x7C,  /* 01111100 */
+    0x60,  /* 01100000 */
+    0xF0,  /* 11110000 */
+
+    /*
+     * code=113, hex=0x71, ascii="q"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x76,  /* 01110110 */
+    0xCC,  /* 11001100 */
+    0xCC,  /* 11001100 */
+    0x7C,  /* 01111100 */
+    0x0C,  /* 00001100 */
+    0x1E,  /* 00011110 */
+
+    /*
+     * code=114, hex=0x72, ascii="r"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0xDC,  /* 11011100 */
+    0x76,  /* 01110110 */
+    0x60,  /* 01100000 */
+    0x60,  /* 01100000 */
+    0xF0,  /* 11110000 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=115, hex=0x73, ascii="s"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x7E,  /* 01111110 */
+    0xC0,  /* 11000000 */
+    0x7C,  /* 01111100 */
+    0x06,  /* 00000110 */
+    0xFC,  /* 11111100 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=116, hex=0x74, ascii="t"
+     */
+    0x30,  /* 00110000 */
+    0x30,  /* 00110000 */
+    0xFC,  /* 11111100 */
+    0x30,  /* 00110000 */
+    0x30,  /* 00110000 */
+    0x36,  /* 00110110 */
+    0x1C,  /* 00011100 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=117, hex=0x75, ascii="u"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0xCC,  /* 11001100 */
+    0xCC,  /* 11001100 */
+    0xCC,  /* 11001100 */
+    0xCC,  /* 11001100 */
+    0x76,  /* 01110110 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=118, hex=0x76, ascii="v"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0xC6,  /* 11000110 */
+    0xC6,  /* 11000110 */
+    0xC6,  /* 11000110 */
+    0x6C,  /* 01101100 */
+    0x38,  /* 00111000 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=119, hex=0x77, ascii="w"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0xC6,  /* 11000110 */
+    0xD6,  /* 11010110 */
+    0xD6,  /* 11010110 */
+    0xFE,  /* 11111110 */
+    0x6C,  /* 01101100 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=120, hex=0x78, ascii="x"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0xC6,  /* 11000110 */
+    0x6C,  /* 01101100 */
+    0x38,  /* 00111000 */
+    0x6C,  /* 01101100 */
+    0xC6,  /* 11000110 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=121, hex=0x79, ascii="y"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0xC6,  /* 11000110 */
+    0xC6,  /* 11000110 */
+    0xC6,  /* 11000110 */
+    0x7E,  /* 01111110 */
+    0x06,  /* 00000110 */
+    0xFC,  /* 11111100 */
+
+    /*
+     * code=122, hex=0x7A, ascii="z"
+     */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x7E,  /* 01111110 */
+    0x4C,  /* 01001100 */
+    0x18,  /* 00011000 */
+    0x32,  /* 00110010 */
+    0x7E,  /* 01111110 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=123, hex=0x7B, ascii="{"
+     */
+    0x0E,  /* 00001110 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x70,  /* 01110000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x0E,  /* 00001110 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=124, hex=0x7C, ascii="|"
+     */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=125, hex=0x7D, ascii="}"
+     */
+    0x70,  /* 01110000 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x0E,  /* 00001110 */
+    0x18,  /* 00011000 */
+    0x18,  /* 00011000 */
+    0x70,  /* 01110000 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=126, hex=0x7E, ascii="~"
+     */
+    0x76,  /* 01110110 */
+    0xDC,  /* 11011100 */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+    0x00,  /* 00000000 */
+
+    /*
+     * code=127, hex=0x7F, ascii="DEL"
+     */
+    0x00,  /* 00000000 */
+    0x10,  /* 00010000 */
+    0x38,  /* 00111000 */
+    0x6C,  /* 01101100 */
+    0xC6,  /* 11000110 */
+    0xC6,  /* 11000110 */
+    0xFE,  /* 11111110 */
+    0x00,  /* 00000000 */
 };
@@ -0,0 +1,59 @@
+/**
+ * Compressed 8x8 font generated by tools/fontpack from font8x8.h - do not edit.
+ *
+ * 96 glyphs from ASCII 32, 497 bytes packed (768 bytes unpacked).
+*/
+#define FONT_FIRST 32
+#define FONT_GLYPHS 96
+#define FONT_BLOCK 16
+
+static const unsigned char font_rows[42] = {
+    0x00, 0xC6, 0x18, 0x7C, 0xC0, 0x06, 0x30, 0x0C, 0x6C, 0xCC, 0xFE, 0x66,
+    0xFC, 0x60, 0x7E, 0x38, 0x3C, 0x76, 0xD6, 0xDC, 0xDE, 0xF8, 0xE0, 0xE6,
+    0xF0, 0x0E, 0x70, 0xCE, 0xD8, 0xFF, 0x10, 0x1C, 0x78, 0xF6, 0x02, 0x1E,
+    0x32, 0x36, 0x4C, 0x80, 0xEC, 0xEE,
+};
+
+static const unsigned int font_block[6] = {
+    0, 140, 279, 428, 572, 727,
+};
+
+static const unsigned char font_codes[443] = {
+    0x00, 0x00, 0x00, 0x00, 0x22, 0x22, 0x20, 0x20, 0x88, 0x80, 0x00, 0x00,
+    0x88, 0xA8, 0xA8, 0x80, 0x2E, 0x04, 0x35, 0xC2, 0x00, 0x19, 0x26, 0xB1,
+    0x0E, 0x18, 0xE1, 0xE3, 0xE5, 0x9E, 0x30, 0x66, 0xD0, 0x00, 0x00, 0x72,
+    0x66, 0x62, 0x70, 0x62, 0x77, 0x72, 0x60, 0x0B, 0xE2, 0xEF, 0xE2, 0xB0,
+    0x00, 0x22, 0xE0, 0x22, 0x00, 0x00, 0x00, 0x02, 0x26, 0x00, 0x0E, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x22, 0x05, 0x72, 0x6D, 0x4F, 0x90, 0x3E, 0xDE,
+    0x6F, 0x3E, 0x91, 0x30, 0x2E, 0x12, 0x22, 0x2E, 0x00, 0x31, 0x53, 0x44,
+    0xA0, 0xC5, 0x5E, 0x25, 0x5C, 0x07, 0x99, 0x9A, 0x77, 0x0A, 0x4C, 0x55,
+    0x13, 0x03, 0x44, 0xC1, 0x13, 0x0A, 0x55, 0x72, 0x66, 0x03, 0x11, 0x31,
+    0x13, 0x03, 0x11, 0xE0, 0x55, 0x30, 0x02, 0x20, 0x02, 0x20, 0x02, 0x20,
+    0x02, 0x26, 0x72, 0x6D, 0x62, 0x70, 0x00, 0xE0, 0x0E, 0x00, 0x00, 0x62,
+    0x75, 0x72, 0x60, 0xE2, 0xB7, 0x22, 0x02, 0x03, 0x1E, 0x6E, 0x6E, 0x64,
+    0xE0, 0x0E, 0x18, 0x11, 0xA1, 0x10, 0xC1, 0x1C, 0x11, 0xC0, 0x31, 0x44,
+    0x41, 0x30, 0xE7, 0x91, 0x11, 0x9E, 0x70, 0xA4, 0x4E, 0x74, 0x4A, 0x0A,
+    0x44, 0xE7, 0x44, 0x40, 0x31, 0x44, 0xED, 0x13, 0x01, 0x11, 0xA1, 0x11,
+    0x0E, 0x02, 0x22, 0x22, 0xE0, 0x05, 0x55, 0x55, 0x13, 0x01, 0x9E, 0xEE,
+    0xAE, 0xE9, 0x10, 0x44, 0x44, 0x44, 0xA0, 0x1F, 0xBA, 0xAE, 0x41, 0x10,
+    0x1E, 0x9F, 0x3E, 0x6E, 0xD1, 0x10, 0x31, 0x11, 0x11, 0x30, 0xC1, 0x1C,
+    0x44, 0x40, 0x31, 0x11, 0xE4, 0xE6, 0x35, 0xC1, 0x1C, 0xEE, 0x91, 0x03,
+    0x14, 0x35, 0x13, 0x0E, 0xF2, 0x22, 0x22, 0x20, 0x11, 0x11, 0x11, 0xA0,
+    0x11, 0x11, 0x13, 0xE1, 0x01, 0x11, 0x1E, 0x4A, 0x80, 0x11, 0x8E, 0x18,
+    0x11, 0x01, 0x11, 0x32, 0x6E, 0x80, 0xA5, 0x72, 0x6D, 0xA0, 0xE2, 0x66,
+    0x66, 0x6E, 0x20, 0x4D, 0x62, 0x75, 0xF4, 0x0E, 0x27, 0x77, 0x77, 0xE2,
+    0x0F, 0x0E, 0x18, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0xEF, 0x22, 0x70,
+    0x00, 0x00, 0x00, 0xF2, 0x73, 0x9E, 0x30, 0xE8, 0xD3, 0xBB, 0xBE, 0x50,
+    0x00, 0x31, 0x41, 0x30, 0xF1, 0x73, 0x99, 0x9E, 0x30, 0x00, 0x31, 0xA4,
+    0x30, 0xE2, 0xBD, 0xE7, 0xDD, 0xEA, 0x00, 0x0E, 0x39, 0x93, 0x7E, 0x7E,
+    0x8D, 0x8E, 0x3B, 0xBE, 0x90, 0x20, 0xE1, 0x22, 0x2E, 0x20, 0x50, 0x55,
+    0x5B, 0xBE, 0x2E, 0x8D, 0xB8, 0xF2, 0x8E, 0x90, 0xE1, 0x22, 0x22, 0x2E,
+    0x20, 0x00, 0xFA, 0xAE, 0x4E, 0x4E, 0x40, 0x00, 0xE5, 0xBB, 0xBB, 0x00,
+    0x03, 0x11, 0x13, 0x00, 0x0E, 0x5B, 0xB3, 0xDE, 0xA0, 0x0E, 0x39, 0x93,
+    0x7F, 0x50, 0x0E, 0x5E, 0x3D, 0xDE, 0xA0, 0x00, 0xE0, 0x43, 0x5C, 0x06,
+    0x6C, 0x66, 0xF7, 0xF1, 0x00, 0x09, 0x99, 0x9E, 0x30, 0x00, 0x11, 0x18,
+    0xE1, 0x00, 0x01, 0xE4, 0xE4, 0xA8, 0x00, 0x01, 0x8E, 0x18, 0x10, 0x00,
+    0x11, 0x1E, 0x05, 0xC0, 0x0E, 0x0F, 0x82, 0xF6, 0xE0, 0x0E, 0xB2, 0x2E,
+    0xC2, 0x2E, 0xB0, 0x22, 0x22, 0x22, 0x20, 0xEC, 0x22, 0xEB, 0x22, 0xEC,
+    0x0E, 0x3E, 0x50, 0x00, 0x00, 0x00, 0xF0, 0xE1, 0x81, 0x1A, 0x00,
+};
@@ -9,24 +9,279 @@
 #include <rp6502.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include "font8x8.h" // covers from ASCII 32 to 95 inclusive.
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "font8x8z.h" // packed font, ASCII 32 to 127 stored, see fontGlyph() for the rest
 
+// Screen geometry and depth are chosen at compile time, eg. -DBPP=2 -DHEIGHT=180.
+// The drawing primitives are built for that depth only so there are no bpp tests
+// at run time.
+
+#ifndef WIDTH
 #define WIDTH 320
+#endif
+#ifndef HEIGHT
 #define HEIGHT 240 // 180 or 240
+#endif
+#ifndef BPP
+#define BPP 4 // bits per pixel, 1 2 4 or 8
+#endif
+
+#if BPP == 1
+#define XSHIFT 3 // x >> XSHIFT is the byte within a line
+#define FILLMUL 0xff // colour * FILLMUL puts it in every pixel of a byte
+#elif BPP == 2
+#define XSHIFT 2
+#define FILLMUL 0x55
+#elif BPP == 4
+#define XSHIFT 1
+#define FILLMUL 0x11
+#elif BPP == 8
+#define XSHIFT 0
+#define FILLMUL 0x01
+#else
+#error "BPP must be 1, 2, 4 or 8"
+#endif
+
+#define PPB (8 / BPP) // pixels per vram byte
+#define STRIDE (WIDTH / PPB) // vram bytes per line
+#define FBSIZE ((uint16_t)STRIDE * HEIGHT) // vram bytes used by the screen
+#define XPIX(x) ((x) & (PPB - 1)) // which pixel of its vram byte x is
+#define FILL(c) ((uint8_t)((c) * FILLMUL))
+
+#if WIDTH < 320 || HEIGHT < 180
+#error "The layout needs at least 320x180"
+#endif
+#if HEIGHT > 255
+#error "y coordinates and line lengths are 8 bit"
+#endif
+#if WIDTH / PPB * HEIGHT > 65535
+#error "Screen does not fit in XRAM"
+#endif
+#if (WIDTH / PPB * HEIGHT) % 16
+#error "gcls() clears 16 bytes at a time"
+#endif
+
+// Mode number for vmode(). Only the 4bpp 320 wide modes are known here, for
+// anything else pass the firmware's mode number with -DVMODE=n.
+#ifndef VMODE
+#if BPP == 4 && WIDTH == 320 && HEIGHT == 240
+#define VMODE 1
+#elif BPP == 4 && WIDTH == 320 && HEIGHT == 180
+#define VMODE 2
+#else
+#error "No known video mode for this geometry, define VMODE"
+#endif
+#endif
+
 #define LB 1 // Left border which should be zero if it were not for the rendering bug
-#define RB 319
+#define RB (WIDTH - 1)
 #define TB 0
-#define BB 239
+#define BB (HEIGHT - 1)
 
 // The following assumes the original 16 colour ANSI palette. Now doubt we will
-// be able to select palettes in the future.
+// be able to select palettes in the future. Fewer colours get picked from it.
+#if BPP == 1
 #define BGCOL 0 // Used as background colour
-#define FGCOL 7 // Used for things like the screen grids and borders
+#define FGCOL 1 // Used for things like the screen grids and borders
+#define TRANSCOL 0 // How transparent (colour 0) sprite pixels are shown in the editor
+#define CURCOL 1 // Cursor frame
+#define TITLEFG 0
+#define TITLEBG 1
+#define SHOWCOL(c) ((c) ? 1 : TRANSCOL) // sprite colour to screen colour
+#elif BPP == 2
+#define BGCOL 0
+#define FGCOL 3
+#define TRANSCOL 1
+#define CURCOL 3
+#define TITLEFG 3
+#define TITLEBG 1
+#define SHOWCOL(c) ((c) ? 2 + ((c) >> 3) : TRANSCOL)
+#else
+#define BGCOL 0
+#define FGCOL 7
+#define TRANSCOL 8
+#define CURCOL 15
+#define TITLEFG 3
+#define TITLEBG 1
+#define SHOWCOL(c) ((c) ? (c) : TRANSCOL)
+#endif
+#define GAPCOL BGCOL // Colour of the gaps between editor cells
+
+// Editor area, a 32x32 sprite shown as PEDPW x PEDPH cells with PEDGAP between them
+
+#define PEDX 8
+#if HEIGHT < 240
+#define PEDY 13
+#else
+#define PEDY 20
+#endif
+#define PEDPW 4
+#define PEDPH 4
+#define PEDGAP 1
+#define PIXW 32
+#define PIXH 32
+#define PBOXW (PIXW * PEDPW) + ((PIXW-1) * PEDGAP) + (2*PEDGAP) +1
+#define PBOXH (PIXH * PEDPH) + ((PIXH-1) * PEDGAP) + (2*PEDGAP) +1
+#define CELLX(k) (PEDX + 1 + PEDGAP + (k) * (PEDPW + PEDGAP)) // screen x of sprite column k
+#define CELLY(j) (PEDY + 1 + PEDGAP + (j) * (PEDPH + PEDGAP)) // screen y of sprite row j
+
+// Status panel right of the editor area
+
+#define STATX 184
+#define STATY 24
+
+// Colour usage is shown as a bar chart of the 16 colours under the status panel
+#define HISTX STATX
+#define HISTY (STATY + 98)
+#define HISTW 8 // per colour
+#define HISTH 20
+
+// One line messages go under the colour chart, and the PROFILE HUD under that
+#define MSGX STATX
+#define MSGY (HISTY + HISTH + 6)
+
+// The font costs 593 bytes in all: 497 packed (font8x8z.h), the 8 byte glyph
+// fontGlyph() decodes into and the 88 byte digit table of digitGlyph(). That is
+// 81 more than the 512 byte table it replaced, which held a third fewer glyphs.
+// Other text is decoded every time, it is mostly drawn once. The digits are kept
+// decoded so number fields cost the same every frame.
+#define SPRBYTES (PIXW * PIXH / 2) // packed 4bpp, even x in the low nibble like vram
+#define FRAMES 8 // animation frames per sprite
+#define DELTA_MAX 1024 // playback offsets kept, see buildDelta()
+#define DELTA_STEP (DELTA_MAX / FRAMES) // offsets kept for each step
+
+// Build with PROFILE defined (cmake -DSPRITED_PROFILE=ON) to count calls, pixels
+// and register accesses per primitive and show them in a HUD. Only whole frames
+// are timed, with clock() and RIA_VSYNC: clock() is an OS call with 1/100s
+// ticks, far too slow and coarse to wrap round a primitive that takes
+// microseconds. The primitives only bump counters, and register accesses are what
+// their drawing costs anyway as every byte goes through the RIA.
+// Without it all the PRF_ macros are empty so release builds pay nothing.
+#ifdef PROFILE
+#include <time.h>
+
+#define PRF_GCLS 0
+#define PRF_SETXYC 1
+#define PRF_FASTLINE 2
+#define PRF_FBOX 3
+#define PRF_RENDER8X8 4
+#define PRF_BLIT 5
+#define PRF_CELL 6
+#define PRF_COUNT 7
+
+#define HUDX 180 // HUD sits right of the editor grid, under the message line
+#define HUDY (MSGY + 10)
+#define HUDH ((3 + PRF_COUNT) * 8)
+
+#if HUDY + HUDH > BB
+#error "No room for the profiling HUD at this HEIGHT"
+#endif
+
+static uint32_t prf_pixels = 0; // pixels written to vram
+static uint32_t prf_regs = 0; // RIA register reads and writes
+static clock_t prf_clock; // clock() at start of frame
+static uint8_t prf_vsync; // RIA_VSYNC at start of frame
+static uint8_t prf_redraw = 1; // HUD labels need drawing
+
+#define PRF_ENTER(p) { mem.prf.calls[p]++; mem.prf.start[p] = prf_regs; }
+#define PRF_LEAVE(p) mem.prf.pregs[p] += prf_regs - mem.prf.start[p]
+#define PRF_PIXELS(n) prf_pixels += (n)
+#define PRF_REGS(n) prf_regs += (n)
+#define PRF_HUD() prfHud()
+#define PRF_REDRAW() prf_redraw = 1
+#else
+#define PRF_ENTER(p)
+#define PRF_LEAVE(p)
+#define PRF_PIXELS(n)
+#define PRF_REGS(n)
+#define PRF_HUD()
+#define PRF_REDRAW()
+#endif
+
+#define DIGITS 5 // enough for any uint16_t
+
+/**
+ * A number on screen that changes often, eg. the cursor position. Only the
+ * digits that differ from what is already drawn get redrawn.
+*/
+typedef struct {
+    uint16_t x;
+    uint8_t y;
+    uint8_t width; // digits shown, right aligned, higher digits are dropped
+    uint8_t fg;
+    uint8_t bg;
+    uint8_t shown[DIGITS]; // what is on screen, 0xff if unknown
+} NumField;
+
+// Memory map. Every table and buffer the editor has is a part of one static
+// block, laid out at compile time, so what each feature costs is known up front
+// (build tools/memmap to print it) and nothing is allocated while it runs. The
+// parts are used as members of mem, eg. mem.cells.dirty. Single flags and
+// counters stay as plain statics next to the code that uses them.
+typedef struct Mem {
+    struct {
+        uint8_t buf[FRAMES][SPRBYTES];
+    } frames;
+    struct {
+        uint16_t delta[FRAMES][DELTA_STEP]; // offsets of the bytes that change in each step
+        uint16_t len[FRAMES]; // how many, or DELTA_FULL
+    } play;
+    struct {
+        uint16_t row[PIXH]; // vram address of the start of each sprite row's cells
+        uint8_t x[PIXW]; // screen x of each sprite column
+        uint8_t shown[PIXW * PIXH]; // screen colour of each cell, 0xff if unknown
+        uint8_t dirty[PIXH * PIXW / 8]; // a bit per cell waiting to be repainted
+        uint8_t dirty_row[PIXH]; // non zero if any cell in the row is marked
+    } cells;
+    struct {
+        uint8_t mix[256]; // screen colour for current << 4 | under
+    } onion;
+    struct {
+        uint8_t mask[PIXH * PIXW / 8]; // a bit per cell covered, laid out like dirty
+        uint8_t next[PIXH * PIXW / 8]; // mask being worked out
+    } shape;
+    struct {
+        uint16_t count[256]; // how often each byte turns up, folded into hist
+        uint16_t hist[16];
+        uint8_t tab[256]; // byte to byte, both pixels mapped
+    } remap;
+    struct {
+        uint8_t glyph[8]; // last glyph decoded by fontGlyph()
+        uint8_t digits[11 * 8]; // '0' to '9' then ' ', decoded once
+#if BPP == 2
+        uint8_t quad[16]; // vram byte for each 4 pixel glyph nibble in quad_fg, quad_bg
+#endif
+    } font;
+    struct {
+        NumField x, y, col, frame, nframes, fps;
+    } stat;
+#ifdef PROFILE
+    struct {
+        uint16_t calls[PRF_COUNT];
+        uint32_t pregs[PRF_COUNT]; // register accesses, including any primitives it calls
+        uint32_t start[PRF_COUNT]; // prf_regs on entry
+        uint16_t shown_calls[PRF_COUNT]; // last frame's counts, copied for prfHud() to show
+        uint32_t shown_pregs[PRF_COUNT];
+        NumField field[4 + 2 * PRF_COUNT];
+    } prf;
+#endif
+} Mem;
+
+// Fails to compile, a negative array size, if the block outgrows the RAM set
+// aside for it. tools/memmap shows where the bytes went.
+#define MEM_BUDGET 9728
+typedef char mem_budget_check[sizeof(Mem) <= MEM_BUDGET ? 1 : -1];
+
+static Mem mem;
+
+
 
 /**
  * vmode(mode)
  * 
- * Sets the video mode to 0 (text) 1 (320x180) or 2 (320x240) with a pixbus write using the xreg command 
+ * Sets the video mode to 0 (text) 1 (320x240) or 2 (320x180) with a pixbus write using the xreg command 
 */
 static void vmode(uint16_t data)
 {
@@ -41,14 +296,16 @@ static void vmode(uint16_t data)
 static void gcls(uint8_t c) {
     unsigned i = 0;
 
-    c += c << 4; // fill the whole byte ie 2 pixels with colour.
+    PRF_ENTER(PRF_GCLS);
+
+    c = FILL(c); // fill the whole byte ie all its pixels with colour.
 
     // Partially unrolled loop is FAST
 
     RIA_ADDR0 = 0; // Start address
     RIA_STEP0 = 1; // amount to auto step on each write to RIA_RW0 register
 
-    for (i = 0x980; --i;) // 0x1300 is 38912d = 320x240 # 4bpp ie 2 pixels per byte
+    for (i = FBSIZE / 16; i > 0; i--) // eg. 38400 bytes for 320x240 @ 4bpp ie 2 pixels per byte
     {
         RIA_RW0 = c;
         RIA_RW0 = c;
@@ -69,93 +326,241 @@ static void gcls(uint8_t c) {
         RIA_RW0 = c;
     }
 
+    PRF_PIXELS((uint32_t)FBSIZE * PPB);
+    PRF_REGS(2 + (uint32_t)FBSIZE);
+    PRF_LEAVE(PRF_GCLS);
+}
+
+// Masks for the pixels of a vram byte, pixel 0 (the leftmost) is in the low bits.
+// eg. at 4bpp even x is the low nibble and odd x the high one.
+#if BPP == 1
+static const uint8_t pix_mask[PPB] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+static const uint8_t from_mask[PPB] = {0xff, 0xfe, 0xfc, 0xf8, 0xf0, 0xe0, 0xc0, 0x80}; // pixel n onwards
+static const uint8_t to_mask[PPB] = {0x01, 0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff}; // up to pixel n
+#elif BPP == 2
+static const uint8_t pix_mask[PPB] = {0x03, 0x0c, 0x30, 0xc0};
+static const uint8_t from_mask[PPB] = {0xff, 0xfc, 0xf0, 0xc0};
+static const uint8_t to_mask[PPB] = {0x03, 0x0f, 0x3f, 0xff};
+#elif BPP == 4
+static const uint8_t pix_mask[PPB] = {0x0f, 0xf0};
+static const uint8_t from_mask[PPB] = {0xff, 0xf0};
+static const uint8_t to_mask[PPB] = {0x0f, 0xff};
+#else
+static const uint8_t pix_mask[PPB] = {0xff};
+static const uint8_t from_mask[PPB] = {0xff};
+static const uint8_t to_mask[PPB] = {0xff};
+#endif
+
+// Clip rectangle, inclusive. Primitives trim what they draw to it before their
+// inner loops rather than testing each pixel. gcls() ignores it.
+static uint16_t clip_l = 0, clip_r = WIDTH - 1;
+static uint8_t clip_t = 0, clip_b = HEIGHT - 1;
+
+/**
+ * setClip(l,t,r,b) / noClip()
+ *
+ * Limit drawing to the rectangle l,t to r,b inclusive / to the whole screen.
+*/
+void setClip(uint16_t l, uint8_t t, uint16_t r, uint8_t b) {
+    clip_l = l;
+    clip_t = t;
+    clip_r = r < WIDTH ? r : WIDTH - 1;
+    clip_b = b < HEIGHT ? b : HEIGHT - 1;
+}
+
+void noClip() {
+    setClip(0, 0, WIDTH - 1, HEIGHT - 1);
 }
+
 /**
- * wait()
+ * plot(x,y,c)
  * 
- * wait for any keypress before returning
+ * setxyc() without the clipping for callers that have already clipped.
 */
-static void wait()
-{
-    uint8_t discard;
-    discard = RIA_RX;
-    while (RIA_RX_READY)
-        discard = RIA_RX;
-    while (!(RIA_RX_READY))
-        ;
-    discard = RIA_RX;
+static void plot(uint16_t x, uint8_t y, uint8_t c) {
+#if BPP != 8
+    uint8_t m = pix_mask[XPIX(x)];
+#endif
+
+    PRF_ENTER(PRF_SETXYC);
+
+    RIA_ADDR0 = ((uint16_t)y * STRIDE) + (x >> XSHIFT); // Start address
+    RIA_STEP0 = 0;  // We don't actually care about the vram address in RIA_ADDR0 incrementing
+
+#if BPP == 8
+    RIA_RW0 = c;
+#else
+    RIA_RW0 = (RIA_RW0 & ~m) | (FILL(c) & m); // just our pixel of the vram byte
+#endif
+
+    PRF_PIXELS(1);
+    PRF_REGS(4);
+    PRF_LEAVE(PRF_SETXYC);
 }
 
 /**
  * setxyc(x,y,c)
  * 
- * Set a pixel at the specified coordinates using the colour c (0-15).
+ * Set a pixel at the specified coordinates using the colour c.
 */
-void setxyc(uint16_t x, uint8_t y, int8_t c) {
-    // c = c & 15; // Only keep colours 0-15 or assume the user has a brain and save the cpu cycles
-    
-    RIA_ADDR0 = (y * 160) + (x >> 1); // Start address
-    RIA_STEP0 = 0;  // We don't actually care about the vram address in RIA_ADDR0 incrementing
+void setxyc(uint16_t x, uint8_t y, uint8_t c) {
+    if (x >= clip_l && x <= clip_r && y >= clip_t && y <= clip_b)
+        plot(x, y, c);
+}
 
-    if ((x & 1) == 0)
-        RIA_RW0 = (RIA_RW0 & 0xf0) | c; // right pixel in vram byte
-    else
-        RIA_RW0 = (RIA_RW0 & 0x0f) | (c << 4); // left pixel in vram byte
-    
+#if BPP != 8
+/**
+ * rmwColumn(a, h, m, v)
+ *
+ * Going down h lines from vram address a, set the pixels in mask m to v (already
+ * masked) leaving the rest of each byte as it was.
+*/
+static void rmwColumn(uint16_t a, uint8_t h, uint8_t m, uint8_t v) {
+    RIA_ADDR0 = a;
+    RIA_STEP0 = 0; // read and write the same byte
+
+    PRF_REGS(2 + 4 * h);
+
+    for (; h > 0; h--) {
+        RIA_RW0 = (RIA_RW0 & ~m) | v;
+        RIA_ADDR0 += STRIDE;
+    }
 }
+#endif
 
 /**
  * fastline(x,y,x1,y1,c) 
  * Draws a (straight h or v only at the moment) in the specified colour. 
 */
 void fastline(uint16_t x0, uint8_t y0, uint16_t x1, uint8_t y1, uint8_t c) {
-    uint8_t rightpix = 0; // 1 if right pixel else 0 for left pixel
-    uint8_t pair = 0;
+    uint8_t m, lm, rm;
+    uint16_t n;
+
+    // Clip once, a vertical line trims y and a horizontal one x
+    if (x0 == x1) {
+        if (x0 < clip_l || x0 > clip_r)
+            return;
+    } else if (y0 < clip_t || y0 > clip_b) {
+        return;
+    }
+    if (y0 < clip_t)
+        y0 = clip_t;
+    if (y1 > clip_b)
+        y1 = clip_b;
+    if (x0 < clip_l)
+        x0 = clip_l;
+    if (x1 > clip_r)
+        x1 = clip_r;
+    if (x0 > x1 || y0 > y1)
+        return;
 
-    // Make both nibbles in the colour the same for later.
-    c += c << 4;
+    PRF_ENTER(PRF_FASTLINE);
+
+    // Colour in every pixel of the byte for later.
+    c = FILL(c);
 
     if (x0 == x1) { // vertical line
         // A vertical line needs a vram start address in RIA_ADDR0 and a step size of 0 in
         // RIA_STEP0 so after each write it does not advance since we need to a read modify write op.
-        // Also need to determine if it is an odd or even X so we know which half of the vram byte
-        // to write for this pixel.
-        RIA_ADDR0 = (y0 * 160) + (x0 >> 1); // address of vram pixel pair
+        // The pixel's mask is the same all the way down.
+        RIA_ADDR0 = ((uint16_t)y0 * STRIDE) + (x0 >> XSHIFT); // address of vram pixel
         RIA_STEP0 = 0;
-        
-        // Determine if this is a left or right nibble pixel
-        rightpix = x0 & 1;
+        m = pix_mask[XPIX(x0)];
+        c &= m;
 
-        while (y0 < y1+1) {
-            if (rightpix == 0) {
-                //RIA_ADDR0 = (y0 * 160) + (x0 >> 1); // address of vram pixel pair
-                RIA_RW0 = (RIA_RW0 & 0xf0) | (c & 0x0f);
-            } else {
-                //RIA_ADDR0 = (y0 * 160) + (x0 >> 1); // address of vram pixel pair
-                RIA_RW0 = (RIA_RW0 & 0x0f) | (c & 0xf0);
-            }
+        PRF_PIXELS(y1 - y0 + 1);
+        PRF_REGS(2 + 4 * (y1 - y0 + 1)); // RW0 read and write, ADDR0 read and write per pixel
 
-            RIA_ADDR0 += 160;
+        while (y0 < y1+1) {
+#if BPP == 8
+            RIA_RW0 = c;
+#else
+            RIA_RW0 = (RIA_RW0 & ~m) | c;
+#endif
+            RIA_ADDR0 += STRIDE;
             y0++;
         }
 
     } else { // horizontal line
-        RIA_ADDR0 = (y0 * 160) + (x0 >> 1); // address of vram pixel pair
+        // Only the bytes at either end can be shared with other pixels, they are read,
+        // modified and written. Whole bytes in between are simply written.
+        lm = from_mask[XPIX(x0)];
+        rm = to_mask[XPIX(x1)];
+        n = (x1 >> XSHIFT) - (x0 >> XSHIFT) + 1; // vram bytes touched
+
+        RIA_ADDR0 = ((uint16_t)y0 * STRIDE) + (x0 >> XSHIFT); // address of first vram byte
         RIA_STEP0 = 0;
 
-        while (x0 < (x1+1)) { // As x is changing we need to keep track of left/right nibbles each loop
-            if ((x0 & 1) == 0) {
-                RIA_RW0 = (RIA_RW0 & 0xf0) | (c & 0x0f);
-            } else {
-                RIA_RW0 = (RIA_RW0 & 0x0f) | (c & 0xf0);
-            }
+        PRF_PIXELS(x1 - x0 + 1);
+        PRF_REGS(8 + n);
 
-            if (x0 & 1)
-                RIA_ADDR0 += 1;
-            x0++;
+        if (n == 1) {
+            m = lm & rm;
+            RIA_RW0 = (RIA_RW0 & ~m) | (c & m);
+        } else {
+            RIA_RW0 = (RIA_RW0 & ~lm) | (c & lm);
+            RIA_ADDR0 += 1;
+            RIA_STEP0 = 1;
+            for (n -= 2; n > 0; n--)
+                RIA_RW0 = c;
+            RIA_STEP0 = 0; // now on the last byte
+            RIA_RW0 = (RIA_RW0 & ~rm) | (c & rm);
         }
-    
     }
+
+    PRF_LEAVE(PRF_FASTLINE);
+}
+
+/**
+ * fontNibble(n)
+ *
+ * Fetch nibble n (high nibble first) of the packed font code stream.
+*/
+static uint8_t fontNibble(uint16_t n) {
+    if (n & 1)
+        return font_codes[n >> 1] & 0x0f;
+    return font_codes[n >> 1] >> 4;
+}
+
+/**
+ * fontGlyph(c)
+ *
+ * Return the 8 byte bitmap for any character code c, decoded from the packed
+ * font. It is only good until the next call.
+ * Codes 32-127 are stored in the font. 0-31 show as the inverse of @,A-Z,[ etc.
+ * (ie ^A is an inverse A) and 128-255 as the inverse of the code without bit 7,
+ * so 129 is an A again.
+*/
+uint8_t * fontGlyph(uint8_t c) {
+    uint8_t * g = mem.font.glyph;
+    uint8_t base, inv, i, t;
+    uint16_t n;
+
+    base = c & 0x7f;
+    inv = (c & 0x80) ? 0xff : 0x00;
+    if (base < FONT_FIRST) {
+        base += 64;
+        inv ^= 0xff;
+    }
+    base -= FONT_FIRST;
+
+    // Every 16th glyph has a known offset, step over the codes of the ones before us
+    n = font_block[base / FONT_BLOCK];
+    for (i = (base & (FONT_BLOCK - 1)) * 8; i > 0; i--) {
+        if (fontNibble(n++) >= 14)
+            n++; // two nibble code
+    }
+
+    for (i = 0; i < 8; i++) {
+        t = fontNibble(n++);
+        if (t == 14)
+            t += fontNibble(n++);
+        else if (t == 15)
+            t = 30 + fontNibble(n++);
+        g[i] = font_rows[t] ^ inv;
+    }
+
+    return g;
 }
 
 /**
@@ -174,170 +579,1792 @@ void fastline(uint16_t x0, uint8_t y0, uint16_t x1, uint8_t y1, uint8_t c) {
  * 0b01000010,
  * 0b00000000
  * 
- * First version in slow mode calling setxyc()
+ * First version in slow mode plotting each pixel, see blitGlyph() for the fast one.
+ * Only the rows and columns inside the clip rectangle are drawn.
 */
 void render8x8(uint8_t * chrgen, uint16_t x, uint8_t y, uint8_t scale, uint8_t fg, uint8_t bg) {
     #define CH 8
     #define CW 8
 
-    uint8_t height = CH, width = CW;
-    uint16_t xtemp = x;
+    uint8_t r0 = 0, r1 = CH - 1, c0 = 0, c1 = CW - 1; // glyph rows and columns left after clipping
+    uint8_t row, col, b;
+    uint16_t xtemp;
 
-    for (height=CH; height>0; height--) { // each line
-        xtemp = x; // left most pixel each line
-        for (width=CW; width>0; width--) { // each pixel across
-            if ((chrgen[8-height] & (1<<width-1)) == 0) // bit is bg colour
-                setxyc(xtemp++,y,bg);
-            else
-                setxyc(xtemp++,y,fg);
+    if (x > clip_r || y > clip_b || x + (CW - 1) < clip_l || y + (CH - 1) < clip_t)
+        return;
+    if (x < clip_l)
+        c0 = clip_l - x;
+    if (x + (CW - 1) > clip_r)
+        c1 = clip_r - x;
+    if (y < clip_t)
+        r0 = clip_t - y;
+    if (y + (CH - 1) > clip_b)
+        r1 = clip_b - y;
+
+    PRF_ENTER(PRF_RENDER8X8);
+
+    for (row = r0; row <= r1; row++) { // each line
+        xtemp = x + c0; // left most pixel each line
+        b = chrgen[row] << c0; // bit 7 is the next pixel
+        for (col = c0; col <= c1; col++) { // each pixel across
+            plot(xtemp++, y + row, (b & 0x80) ? fg : bg);
+            b <<= 1;
         }
-        y++; // next line
     }
+
+    PRF_LEAVE(PRF_RENDER8X8);
 }
 
 /**
  * renderStr(string etc)
  * 
- * Render a null (0x00) terminated string using specified font at x,y in fg,bg colours.
- * As far as this code is concerned the *font must point to the start of the code for ASCII 32 ie a space.
+ * Render a null (0x00) terminated string at x,y in fg,bg colours.
+ * Any byte value is safe, see fontGlyph().
 */
-void renderStr(uint8_t * str, uint8_t * font, uint16_t x, uint8_t y, uint8_t scale, uint8_t fg, uint8_t bg) {
-    while(*str) { // OMG no error checking - the sky is falling....
-        render8x8(&font[(*str-32)*8], x, y, scale, fg, bg);
+void renderStr(uint8_t * str, uint16_t x, uint8_t y, uint8_t scale, uint8_t fg, uint8_t bg) {
+    while(*str) {
+        render8x8(fontGlyph(*str), x, y, scale, fg, bg);
         x+=8;
         str++;
     }
 }
 
+#if BPP == 1
+static const uint8_t rev4[16] = {0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe, 0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7, 0xf};
+#elif BPP == 2
+static uint8_t quad_fg = 0xff, quad_bg = 0xff;
+#endif
+
+/**
+ * blitGlyph(*chrgen, x, y, fg, bg)
+ *
+ * Fast render8x8 for an x on a vram byte boundary (see XPIX): each glyph row goes
+ * straight to vram as whole bytes, 8 / PPB of them. The leftmost glyph pixel
+ * (bit 7) goes in the lowest pixel of a byte, see setxyc().
+*/
+void blitGlyph(uint8_t * chrgen, uint16_t x, uint8_t y, uint8_t fg, uint8_t bg) {
+    uint16_t a;
+    uint8_t i, b, r0 = 0, r1 = 7;
+#if BPP == 1
+    uint8_t f = FILL(fg), g = FILL(bg);
+#elif BPP == 2
+    uint8_t p;
+#elif BPP == 4
+    uint8_t pair[4];
+#endif
+
+    // Whole rows can be clipped here, anything cut off at the sides goes the slow way
+    if (x < clip_l || x + 7 > clip_r) {
+        render8x8(chrgen, x, y, 1, fg, bg);
+        return;
+    }
+    if (y > clip_b || y + 7 < clip_t)
+        return;
+    if (y < clip_t)
+        r0 = clip_t - y;
+    if (y + 7 > clip_b)
+        r1 = clip_b - y;
+    a = ((uint16_t)(y + r0) * STRIDE) + (x >> XSHIFT);
+
+    PRF_ENTER(PRF_BLIT);
+
+#if BPP == 2
+    if (fg != quad_fg || bg != quad_bg) { // byte for each nibble, rebuilt when the colours change
+        for (i = 0; i < 16; i++) {
+            b = 0;
+            for (p = 0; p < 4; p++)
+                b |= ((i & (8 >> p)) ? fg : bg) << (p * 2);
+            mem.font.quad[i] = b;
+        }
+        quad_fg = fg;
+        quad_bg = bg;
+    }
+#elif BPP == 4
+    // Left pixel of a pair (bit 7 of the row) is the low nibble
+    pair[0] = bg | (bg << 4);
+    pair[1] = bg | (fg << 4);
+    pair[2] = fg | (bg << 4);
+    pair[3] = fg | (fg << 4);
+#endif
+
+    RIA_STEP0 = 1;
+    for (i = r0; i <= r1; i++) {
+        RIA_ADDR0 = a;
+        b = chrgen[i];
+#if BPP == 1
+        b = rev4[b >> 4] | (rev4[b & 15] << 4);
+        RIA_RW0 = (b & f) | (~b & g);
+#elif BPP == 2
+        RIA_RW0 = mem.font.quad[b >> 4];
+        RIA_RW0 = mem.font.quad[b & 15];
+#elif BPP == 4
+        RIA_RW0 = pair[b >> 6];
+        RIA_RW0 = pair[(b >> 4) & 3];
+        RIA_RW0 = pair[(b >> 2) & 3];
+        RIA_RW0 = pair[b & 3];
+#else
+        RIA_RW0 = (b & 0x80) ? fg : bg;
+        RIA_RW0 = (b & 0x40) ? fg : bg;
+        RIA_RW0 = (b & 0x20) ? fg : bg;
+        RIA_RW0 = (b & 0x10) ? fg : bg;
+        RIA_RW0 = (b & 0x08) ? fg : bg;
+        RIA_RW0 = (b & 0x04) ? fg : bg;
+        RIA_RW0 = (b & 0x02) ? fg : bg;
+        RIA_RW0 = (b & 0x01) ? fg : bg;
+#endif
+        a += STRIDE;
+    }
+
+    PRF_PIXELS(8 * (r1 - r0 + 1));
+    PRF_REGS(1 + (r1 - r0 + 1) * (1 + 8 / PPB));
+    PRF_LEAVE(PRF_BLIT);
+}
+
+#define DIGIT_BLANK 10 // digit value shown as a space ie leading zeros
+
+static uint8_t digit_ready = 0;
+
+static const uint16_t pow10[DIGITS - 1] = {10000, 1000, 100, 10};
+
+/**
+ * toDigits(v, *d)
+ *
+ * Binary to unpacked BCD, most significant digit first, by subtracting powers of
+ * ten rather than dividing. Leading zeros come back as DIGIT_BLANK.
+*/
+static void toDigits(uint16_t v, uint8_t * d) {
+    uint8_t i, n, lead = 1;
+
+    for (i = 0; i < DIGITS - 1; i++) {
+        for (n = 0; v >= pow10[i]; n++)
+            v -= pow10[i];
+        if (n)
+            lead = 0;
+        d[i] = lead ? DIGIT_BLANK : n;
+    }
+    d[DIGITS - 1] = v; // units always shown so 0 is "0"
+}
+
+/**
+ * digitGlyph(d)
+ *
+ * Bitmap for digit value d (0-9 or DIGIT_BLANK).
+*/
+static uint8_t * digitGlyph(uint8_t d) {
+    uint8_t i;
+
+    if (!digit_ready) {
+        for (i = 0; i < 10; i++)
+            memcpy(&mem.font.digits[i * 8], fontGlyph('0' + i), 8);
+        memcpy(&mem.font.digits[DIGIT_BLANK * 8], fontGlyph(' '), 8);
+        digit_ready = 1;
+    }
+
+    return &mem.font.digits[d * 8];
+}
+
+/**
+ * renderGlyph(*chrgen, x, y, fg, bg)
+ *
+ * Draw a glyph, blitting when x is on a vram byte boundary.
+*/
+static void renderGlyph(uint8_t * chrgen, uint16_t x, uint8_t y, uint8_t fg, uint8_t bg) {
+    if (XPIX(x) == 0)
+        blitGlyph(chrgen, x, y, fg, bg);
+    else
+        render8x8(chrgen, x, y, 1, fg, bg);
+}
+
+/**
+ * renderInt(x, y, v, fg, bg)
+ *
+ * Render v left aligned at x,y in fg,bg colours.
+*/
 void renderInt(uint16_t x, uint8_t y, uint16_t v, uint8_t fg, uint8_t bg) {
-    uint8_t s[] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00};
-    itoa(v, s, 10);
-    renderStr(s, console_font_8x8, x, y, 1, 7, 0);
+    uint8_t d[DIGITS];
+    uint8_t i;
+
+    toDigits(v, d);
+    for (i = 0; i < DIGITS; i++) {
+        if (d[i] != DIGIT_BLANK) {
+            renderGlyph(digitGlyph(d[i]), x, y, fg, bg);
+            x += 8;
+        }
+    }
+}
+
+/**
+ * numField(*f, x, y, width, fg, bg)
+ *
+ * Set up a field. Also call this after the screen under it has been redrawn.
+*/
+void numField(NumField * f, uint16_t x, uint8_t y, uint8_t width, uint8_t fg, uint8_t bg) {
+    f->x = x;
+    f->y = y;
+    f->width = width;
+    f->fg = fg;
+    f->bg = bg;
+    memset(f->shown, 0xff, DIGITS);
+}
+
+/**
+ * renderNum(*f, v)
+ *
+ * Show v in field f, only touching vram for digits that changed.
+*/
+void renderNum(NumField * f, uint16_t v) {
+    uint8_t d[DIGITS];
+    uint8_t i;
+    uint16_t x = f->x;
+
+    toDigits(v, d);
+    for (i = DIGITS - f->width; i < DIGITS; i++) {
+        if (d[i] != f->shown[i]) {
+            renderGlyph(digitGlyph(d[i]), x, f->y, f->fg, f->bg);
+            f->shown[i] = d[i];
+        }
+        x += 8;
+    }
 }
 
 /**
- * fbox(x,y,w,h,c)
+ * fbox(x,y,w,h,fg,bg)
  * 
  * Draw a filled box at x,y with w,h etc. Use writes to vram for quickernesses
  * Note the max w,h is limited by the uint8_t to 255.
+ * Nothing is read back, so other pixels sharing a vram byte with the left or
+ * right edge of the box are set to bg, unless they are outside the clip rectangle.
+ * A box wholly outside the clip rectangle draws nothing.
 */
 void fbox(uint16_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t fg, uint8_t bg) {
-    uint8_t i,j,k; // Old Fortran programmers salivate...
-
-    // probably want to start by working out if we start on a full byte.
-
-    if ((x & 1) == 1) { // starting on right pixel so half byte
-        //renderStr("HALF AT START",console_font_8x8,200,62,1,7,0);
-        // handle half byte
-        RIA_ADDR0 = (y * 160) + (x >> 1); // figure out the starting address
-        RIA_STEP0 = 0; // Can't use 160 so add it manually
-        i = (fg << 4) + bg; // colour and bg to set
+    uint16_t a, x1;
+    uint8_t j, k, n, m, f, l, r;
+#if BPP != 8
+    uint8_t g, mc;
+#endif
 
-        for (j=0; j<h; j++) {
-            RIA_RW0 = i;
-            RIA_ADDR0 += 160;
-        }
+    if (w == 0 || h == 0)
+        return;
 
-        x++; // Reduce the work left to do (whole byte pairs)
-        w--; 
+    // Clip once, then the loops only see the part of the box that is left
+    x1 = x + w - 1;
+    if (x > clip_r || y > clip_b || x1 < clip_l || y + (h - 1) < clip_t)
+        return;
+    if (x < clip_l)
+        x = clip_l;
+    if (x1 > clip_r)
+        x1 = clip_r;
+    if (y < clip_t) {
+        h -= clip_t - y;
+        y = clip_t;
     }
+    if (y + (h - 1) > clip_b)
+        h = clip_b - y + 1;
 
-    // and if we end on a half byte
-    if ((x+w) & 1 == 1) { // finishing on left pixel so half byte
-        //renderStr("HALF AT END",console_font_8x8,200,70,1,7,0);
-        // handle half byte
-        RIA_ADDR0 = (y * 160) + ((x+w-1) >> 1); // figure out the starting address
-        RIA_STEP0 = 0;
-        i = (bg << 4) + fg; // colour and bg to set
+    PRF_ENTER(PRF_FBOX);
+    PRF_PIXELS((x1 - x + 1) * h);
 
-        for (j=0; j<h; j++) {
-            RIA_RW0 = i;
-            RIA_ADDR0 += 160;
-        }
+    f = FILL(fg);
 
-        w--; // Reduce the work left to do (whole byte pairs)     
+#if BPP != 8
+    // When the vram byte at an edge reaches outside the clip rectangle the pixels
+    // of it out there must be left alone, so that column is read-modify-written
+    // instead. mc is the part of the byte inside the clip rectangle, which gets fg
+    // where the box is (m) and bg elsewhere like any other edge byte.
+    g = FILL(bg);
+    if ((x & ~(PPB - 1)) < clip_l) {
+        mc = from_mask[XPIX(clip_l)];
+        if ((clip_r >> XSHIFT) == (x >> XSHIFT))
+            mc &= to_mask[XPIX(clip_r)];
+        m = from_mask[XPIX(x)];
+        if ((x >> XSHIFT) == (x1 >> XSHIFT))
+            m &= to_mask[XPIX(x1)];
+        rmwColumn(((uint16_t)y * STRIDE) + (x >> XSHIFT), h, mc, (f & m) | (g & mc & ~m));
+        x = (x | (PPB - 1)) + 1; // start of the next byte
     }
+    if ((x1 | (PPB - 1)) > clip_r && x <= x1) {
+        mc = to_mask[XPIX(clip_r)]; // the byte starts inside, or the case above had it
+        m = to_mask[XPIX(x1)];
+        a = ((uint16_t)y * STRIDE) + (x1 >> XSHIFT);
+        if ((x >> XSHIFT) == (x1 >> XSHIFT)) {
+            m &= from_mask[XPIX(x)];
+            x = x1 + 1; // nothing left after this
+        } else {
+            x1 = (x1 | (PPB - 1)) - PPB; // end of the byte before
+        }
+        rmwColumn(a, h, mc, (f & m) | (g & mc & ~m));
+    }
+    if (x > x1) {
+        PRF_LEAVE(PRF_FBOX);
+        return;
+    }
+#endif
 
-    i = fg + (fg<<4); // fill full byte with colour
+    a = ((uint16_t)y * STRIDE) + (x >> XSHIFT);
+    n = (x1 >> XSHIFT) - (x >> XSHIFT) + 1; // vram bytes per row
 
-    // Don't both odd edges (if they existed) so now will the middle
-    for (j=0; j<h; j++) {
-        k = w / 2; // how many bytes wide is the middle?
-        RIA_ADDR0 = (y++ * 160) + ((x) >> 1);
-        RIA_STEP0 = 1; // moving sideways in fill
+    // Work out the byte for each end once, whole bytes come out as f anyway
+    m = from_mask[XPIX(x)];
+    if (n == 1)
+        m &= to_mask[XPIX(x1)];
+    l = (f & m) | (FILL(bg) & ~m);
+    m = to_mask[XPIX(x1)];
+    r = (f & m) | (FILL(bg) & ~m);
 
-        for (k; k>0; k--) { 
-            RIA_RW0 = i;
+    PRF_REGS(1 + (uint16_t)h * (1 + n));
+
+    RIA_STEP0 = 1; // moving sideways in fill
+    for (j = h; j > 0; j--) {
+        RIA_ADDR0 = a;
+        RIA_RW0 = l;
+        if (n > 1) {
+            for (k = n - 2; k > 0; k--)
+                RIA_RW0 = f;
+            RIA_RW0 = r;
         }
+        a += STRIDE;
     }
+
+    PRF_LEAVE(PRF_FBOX);
 }
 
+#ifdef PROFILE
+static const char * const prf_name[PRF_COUNT] = {"CLS", "PIXEL", "LINE", "BOX", "CHAR", "BLIT", "CELL"};
+
 /**
- * drawLayout()
- * 
- * Draw the borders around the different screen areas, static text etc.
+ * prfBig(*f, v)
+ *
+ * Show a 32 bit count in a field, in units of 1024 with a K after it when too big.
 */
-void drawLayout() {
-    uint8_t i,j,k;
+static void prfBig(NumField * f, uint32_t v) {
+    if (v > 0xffff) {
+        renderNum(f, v >> 10);
+        renderGlyph(fontGlyph('K'), f->x + f->width * 8, f->y, f->fg, f->bg);
+    } else {
+        renderNum(f, v);
+        renderGlyph(digitGlyph(DIGIT_BLANK), f->x + f->width * 8, f->y, f->fg, f->bg);
+    }
+}
 
-    gcls(BGCOL);
+/**
+ * prfHud()
+ *
+ * Show what the last frame cost: clock ticks and vsyncs, pixels and register accesses
+ * written, then calls and register accesses for each primitive. The counters are
+ * copied first and reset after so the HUD's own drawing isn't charged to the next frame.
+*/
+void prfHud() {
+    uint32_t pixels = prf_pixels, regs = prf_regs;
+    uint16_t frame = clock() - prf_clock;
+    uint8_t frames = RIA_VSYNC - prf_vsync;
+    uint8_t i, y = HUDY;
 
-    // Outside border
-    fastline(LB,TB,LB,BB,FGCOL); // vertical line at right
-    fastline(RB,TB,RB,BB,FGCOL); // Vertical line at left
+    memcpy(mem.prf.shown_calls, mem.prf.calls, sizeof(mem.prf.calls));
+    memcpy(mem.prf.shown_pregs, mem.prf.pregs, sizeof(mem.prf.pregs));
 
-    fastline(LB,TB,RB,TB,FGCOL); // horizontal line at top
-    fastline(LB,BB,RB,BB,FGCOL); // horizontal line at bottom
+    if (prf_redraw) {
+        renderStr("FRAME", HUDX, y, 1, FGCOL, BGCOL);
+        numField(&mem.prf.field[0], HUDX + 48, y, 5, FGCOL, BGCOL);
+        numField(&mem.prf.field[1], HUDX + 96, y, 5, FGCOL, BGCOL);
+        renderStr("PIXEL", HUDX, y + 8, 1, FGCOL, BGCOL);
+        numField(&mem.prf.field[2], HUDX + 88, y + 8, 5, FGCOL, BGCOL);
+        renderStr("REGS", HUDX, y + 16, 1, FGCOL, BGCOL);
+        numField(&mem.prf.field[3], HUDX + 88, y + 16, 5, FGCOL, BGCOL);
+        for (i = 0; i < PRF_COUNT; i++) {
+            renderStr((uint8_t *)prf_name[i], HUDX, y + 24 + i * 8, 1, FGCOL, BGCOL);
+            numField(&mem.prf.field[4 + i * 2], HUDX + 48, y + 24 + i * 8, 5, FGCOL, BGCOL);
+            numField(&mem.prf.field[5 + i * 2], HUDX + 88, y + 24 + i * 8, 5, FGCOL, BGCOL);
+        }
+        prf_redraw = 0;
+    }
 
-    renderStr("SPRITE EDITOR BY I.MEINS - JUNE 23", console_font_8x8, 28, 4, 1, 3, 1);
+    renderNum(&mem.prf.field[0], frame);
+    renderNum(&mem.prf.field[1], frames);
+    prfBig(&mem.prf.field[2], pixels);
+    prfBig(&mem.prf.field[3], regs);
+    for (i = 0; i < PRF_COUNT; i++) {
+        renderNum(&mem.prf.field[4 + i * 2], mem.prf.shown_calls[i]);
+        prfBig(&mem.prf.field[5 + i * 2], mem.prf.shown_pregs[i]);
+    }
 
-    // Draw a 32x32 editor area
-    // eg 32 * 5 wide
+    memset(mem.prf.calls, 0, sizeof(mem.prf.calls));
+    memset(mem.prf.pregs, 0, sizeof(mem.prf.pregs));
+    prf_pixels = 0;
+    prf_regs = 0;
+    prf_clock = clock();
+    prf_vsync = RIA_VSYNC;
+}
+#endif
 
-    #define PEDX 8
-    #define PEDY 20
-    #define PEDPW 4
-    #define PEDPH 4
-    #define PEDGAP 1
-    #define PIXW 32
-    #define PIXH 32
-    #define PBOXW (PIXW * PEDPW) + ((PIXW-1) * PEDGAP) + (2*PEDGAP) +1
-    #define PBOXH (PIXH * PEDPH) + ((PIXH-1) * PEDGAP) + (2*PEDGAP) +1
+#define KEY_UP 0x80 // cursor keys, anything else is returned as its ASCII code
+#define KEY_DOWN 0x81
+#define KEY_RIGHT 0x82
+#define KEY_LEFT 0x83
 
-    // bordering box
-    fastline(PEDX, PEDY, PEDX+PBOXW, PEDY, FGCOL);
-    fastline(PEDX, PEDY, PEDX, PEDY+PBOXH, FGCOL);
+static uint8_t esc_state = 0; // progress through an ESC [ x cursor key sequence
 
-    fastline(PEDX, PEDY+PBOXH, PEDX+PBOXW, PEDY+PBOXH, FGCOL);
-    fastline(PEDX+PBOXW, PEDY, PEDX+PBOXW, PEDY+PBOXH, FGCOL);
+/**
+ * getKey()
+ *
+ * Return the next key typed or 0 if there isn't one. Does not wait.
+ * The ANSI cursor key sequences ESC [ A to D come back as KEY_UP etc.
+*/
+static uint8_t getKey() {
+    uint8_t c;
 
-    // Draw the pixels in the edit area
+    if (!(RIA_RX_READY))
+        return 0;
+    c = RIA_RX;
 
-    for (j=0; j<PIXH; j++) { // the rows
-        for (k=0; k<PIXW; k++) { // the columns
-            fbox(PEDX+1+PEDGAP+(k * PEDPW)+(k * PEDGAP), PEDY+1+PEDGAP+(j * PEDPH)+(j * PEDGAP), PEDPW, PEDPH, 8,0);
+    switch (esc_state) {
+    case 0:
+        if (c == 27) {
+            esc_state = 1;
+            return 0;
         }
+        return c;
+    case 1:
+        esc_state = (c == '[') ? 2 : 0;
+        return (c == '[') ? 0 : c;
+    default:
+        esc_state = 0;
+        if (c >= 'A' && c <= 'D')
+            return KEY_UP + (c - 'A');
+        return 0;
     }
+}
 
+static uint8_t * sprite = mem.frames.buf[0]; // the frame being edited
+static uint8_t frame = 0; // its number
+static uint8_t nframes = 1;
 
+// Playback steps from each frame to the next (the last wraps to the first) by
+// rewriting just the bytes that differ. Each step has a fixed slice of the
+// offsets, worked out when it is next played after either of its frames changed,
+// so drawing during playback only costs the two steps next to the frame drawn on.
+// A step that doesn't fit its slice is done as a full copy.
+#define DELTA_FULL 0xffff
 
-    fbox(238,40,4,8,15,14);
+static uint8_t delta_ok = 0; // a bit for each step whose offsets are up to date
 
-    //render8x8(&console_font_8x8[40], 10, 10, 1, 1,7);
+/**
+ * frameChanged(f)
+ *
+ * Frame f has been drawn on, the steps into and out of it need working out again.
+*/
+static void frameChanged(uint8_t f) {
+    delta_ok &= ~((1 << f) | (1 << (f ? f - 1 : nframes - 1)));
 }
 
-void main()
-{
-    uint16_t x = 0;
-    uint8_t y = 0;
+// Frames are autosaved one file each while the editor is idle, see autosave().
+// Build with AUTOSAVE 0 to leave it out (the host tools do).
+#ifndef AUTOSAVE
+#define AUTOSAVE 1
+#endif
+
+#if AUTOSAVE
+#define AUTOSAVE_WAIT 60 // vsyncs with no changes before saving starts
+#define AUTOSAVE_BYTES 64 // most written in one go round the main loop
+
+#if SPRBYTES % AUTOSAVE_BYTES
+#error AUTOSAVE_BYTES must divide the sprite size
+#endif
 
-    #if (HEIGHT == 180)
-    vmode(2);
+static uint8_t save_dirty = 0; // a bit for each frame changed since it was saved
+static uint8_t save_wait = 0; // vsyncs to go before saving
+#define SAVE_MARK(bits) { save_dirty |= (bits); save_wait = AUTOSAVE_WAIT; }
 #else
-    vmode(1);
+#define SAVE_MARK(bits)
 #endif
 
-    drawLayout();
+// Onion skin shows the frame before (and after) dimmed in the empty cells of the
+// one being edited. mem.onion.mix[] gives the screen colour for every pair of
+// sprite colours, current frame in the high nibble of the index and the one
+// under it in the low, so two packed bytes give a cell's colour with one lookup.
+#define ONION_OFF 0
+#define ONION_PREV 1
+#define ONION_BOTH 2 // previous, or next where the previous is empty
+static uint8_t onion = ONION_OFF;
+static const char * const onion_name[3] = {"OFF", "PRV", "P+N"};
+
+#if BPP >= 4
+#define ONIONCOL(c) ((c) >= 9 ? (c) - 8 : BGCOL) // bright colours dim to normal, the rest to black
+#else
+#define ONIONCOL(c) BGCOL // not enough colours, onion pixels look like gaps
+#endif
+
+
+// Shape being dragged out from an anchor to the cursor, shown over the sprite
+// until it is put down. mem.shape.mask has a bit per cell, laid out like
+// mem.cells.dirty.
+#define SHAPE_NONE 0
+#define SHAPE_LINE 1
+#define SHAPE_RECT 2
+#define SHAPE_OVAL 3
+static uint8_t shape = SHAPE_NONE;
+static uint8_t shape_fill = 0;
+static uint8_t shape_x, shape_y; // anchor
+static uint8_t shape_col; // screen colour of the rubber band
+static const char * const shape_name[4] = {"OFF", "LIN", "BOX", "OVL"};
+
+static uint8_t playing = 0;
+static uint8_t play_frame = 0; // frame shown in the preview while playing
+static uint8_t fps = 8;
+static uint8_t play_vsync; // RIA_VSYNC last time playback was looked at
+static uint16_t play_acc; // fps added up every vsync, a frame is due each 60
+
+/**
+ * initCells()
+ *
+ * Work out the cell positions once so painting a cell needs no multiplies, and
+ * the onion skin colour table.
+*/
+static void initCells() {
+    uint8_t i, c, u;
 
-    wait();
+    for (c = 0; c < 16; c++)
+        for (u = 0; u < 16; u++)
+            mem.onion.mix[(c << 4) | u] = c ? SHOWCOL(c) : (u ? ONIONCOL(u) : TRANSCOL);
+
+    for (i = 0; i < PIXW; i++)
+        mem.cells.x[i] = CELLX(i);
+    for (i = 0; i < PIXH; i++)
+        mem.cells.row[i] = (uint16_t)CELLY(i) * STRIDE;
+}
+
+/**
+ * getPixel(x,y) / putPixel(x,y,c)
+ *
+ * Read and write a pixel of the sprite being edited.
+*/
+uint8_t getPixel(uint8_t x, uint8_t y) {
+    uint8_t b = sprite[y * (PIXW / 2) + (x >> 1)];
+
+    return (x & 1) ? b >> 4 : b & 0x0f;
+}
+
+void putPixel(uint8_t x, uint8_t y, uint8_t c) {
+    uint8_t * b = &sprite[y * (PIXW / 2) + (x >> 1)];
+
+    frameChanged(frame);
+    SAVE_MARK(1 << frame);
+
+    if (x & 1)
+        *b = (*b & 0x0f) | (c << 4);
+    else
+        *b = (*b & 0xf0) | c;
+}
+
+#if (BPP == 4 || BPP == 8) && PEDPW == 4 && PEDPH == 4
+/**
+ * cellInClip(k, j)
+ *
+ * True if the cell for sprite pixel k,j and its gaps are inside the clip rectangle.
+*/
+static uint8_t cellInClip(uint8_t k, uint8_t j) {
+    return mem.cells.x[k] - PEDGAP >= clip_l && mem.cells.x[k] + PEDPW + PEDGAP - 1 <= clip_r
+        && CELLY(j) >= clip_t && CELLY(j) + PEDPH - 1 <= clip_b;
+}
+#endif
+
+/**
+ * cellRows(k, j, c)
+ *
+ * The general way to fill a cell, a clipped horizontal line per row. Below 4bpp
+ * neighbouring cells share vram bytes so the ends have to be read-modify-written.
+*/
+static void cellRows(uint8_t k, uint8_t j, uint8_t c) {
+    uint16_t x = mem.cells.x[k];
+    uint8_t y = CELLY(j), i;
+
+    for (i = 0; i < PEDPH; i++)
+        fastline(x, y + i, x + PEDPW - 1, y + i, c);
+}
+
+/**
+ * paintCell(k, j, c)
+ *
+ * Fill the editor cell for sprite pixel k,j with screen colour c (no SHOWCOL mapping).
+ * For the standard 4x4 cells with a 1 pixel gap at 4bpp this is a fixed sequence of
+ * vram writes with no reads: a cell at an even x is 2 whole bytes a row, one at an
+ * odd x is 3 bytes a row where the outer nibbles are the gaps, written as GAPCOL. So
+ * anything drawn in the gaps, eg. the cursor, needs redrawing afterwards.
+ * 8bpp has its own 4 bytes a row version, other depths and geometries use
+ * cellRows(), as does a cell that is not wholly inside the clip rectangle.
+*/
+void paintCell(uint8_t k, uint8_t j, uint8_t c) {
+#if BPP == 4 && PEDPW == 4 && PEDPH == 4 && PEDGAP == 1
+    uint8_t x = mem.cells.x[k];
+    uint16_t a = mem.cells.row[j] + (x >> 1);
+    uint8_t cc = c | (c << 4);
+    uint8_t lo, hi;
+
+    if (!cellInClip(k, j)) {
+        cellRows(k, j, c);
+        return;
+    }
+
+    PRF_ENTER(PRF_CELL);
+
+    RIA_STEP0 = 1;
+    if ((x & 1) == 0) {
+        RIA_ADDR0 = a;
+        RIA_RW0 = cc;
+        RIA_RW0 = cc;
+        RIA_ADDR0 = a + STRIDE;
+        RIA_RW0 = cc;
+        RIA_RW0 = cc;
+        RIA_ADDR0 = a + 2 * STRIDE;
+        RIA_RW0 = cc;
+        RIA_RW0 = cc;
+        RIA_ADDR0 = a + 3 * STRIDE;
+        RIA_RW0 = cc;
+        RIA_RW0 = cc;
+        PRF_REGS(1 + 4 * 3);
+    } else {
+        lo = GAPCOL | (c << 4); // gap then first pixel
+        hi = c | (GAPCOL << 4); // last pixel then gap
+        RIA_ADDR0 = a;
+        RIA_RW0 = lo;
+        RIA_RW0 = cc;
+        RIA_RW0 = hi;
+        RIA_ADDR0 = a + STRIDE;
+        RIA_RW0 = lo;
+        RIA_RW0 = cc;
+        RIA_RW0 = hi;
+        RIA_ADDR0 = a + 2 * STRIDE;
+        RIA_RW0 = lo;
+        RIA_RW0 = cc;
+        RIA_RW0 = hi;
+        RIA_ADDR0 = a + 3 * STRIDE;
+        RIA_RW0 = lo;
+        RIA_RW0 = cc;
+        RIA_RW0 = hi;
+        PRF_REGS(1 + 4 * 4);
+    }
+
+    PRF_PIXELS(16);
+    PRF_LEAVE(PRF_CELL);
+#elif BPP == 8 && PEDPW == 4 && PEDPH == 4
+    uint16_t a = mem.cells.row[j] + mem.cells.x[k];
+
+    if (!cellInClip(k, j)) {
+        cellRows(k, j, c);
+        return;
+    }
+
+    PRF_ENTER(PRF_CELL);
+
+    // A byte per pixel so every cell is the same, 4 bytes a row and the gaps are left alone
+    RIA_STEP0 = 1;
+    RIA_ADDR0 = a;
+    RIA_RW0 = c;
+    RIA_RW0 = c;
+    RIA_RW0 = c;
+    RIA_RW0 = c;
+    RIA_ADDR0 = a + STRIDE;
+    RIA_RW0 = c;
+    RIA_RW0 = c;
+    RIA_RW0 = c;
+    RIA_RW0 = c;
+    RIA_ADDR0 = a + 2 * STRIDE;
+    RIA_RW0 = c;
+    RIA_RW0 = c;
+    RIA_RW0 = c;
+    RIA_RW0 = c;
+    RIA_ADDR0 = a + 3 * STRIDE;
+    RIA_RW0 = c;
+    RIA_RW0 = c;
+    RIA_RW0 = c;
+    RIA_RW0 = c;
+
+    PRF_PIXELS(16);
+    PRF_REGS(1 + 4 * 5);
+    PRF_LEAVE(PRF_CELL);
+#else
+    cellRows(k, j, c);
+#endif
+}
+
+/**
+ * underByte(o)
+ *
+ * Byte o of what the onion skin shows under the current frame, 0 when it is off.
+*/
+static uint8_t underByte(uint16_t o) {
+    uint8_t p, n, m;
+
+    if (onion == ONION_OFF || nframes == 1)
+        return 0;
+
+    p = mem.frames.buf[frame ? frame - 1 : nframes - 1][o];
+    if (onion == ONION_PREV)
+        return p;
+
+    // Next frame's pixels fill in where the previous frame's are empty
+    n = mem.frames.buf[frame + 1 < nframes ? frame + 1 : 0][o];
+    m = ((p & 0x0f) ? 0x0f : 0) | ((p & 0xf0) ? 0xf0 : 0);
+    return p | (n & ~m);
+}
+
+/**
+ * showPixel(k, j)
+ *
+ * Repaint the cell for sprite pixel k,j from the sprite and the onion skin,
+ * unless it already shows that colour.
+*/
+void showPixel(uint8_t k, uint8_t j) {
+    uint16_t o = j * (PIXW / 2) + (k >> 1);
+    uint8_t a = sprite[o], u = underByte(o);
+    uint8_t * shown = &mem.cells.shown[j * PIXW + k];
+    uint8_t c;
+
+    if (k & 1)
+        c = mem.onion.mix[(a & 0xf0) | (u >> 4)];
+    else
+        c = mem.onion.mix[(uint8_t)(a << 4) | (u & 0x0f)];
+    if (mem.shape.mask[j * (PIXW / 8) + (k >> 3)] & (1 << (k & 7)))
+        c = shape_col;
+
+    if (c != *shown) {
+        paintCell(k, j, c);
+        *shown = c;
+    }
+}
+
+/**
+ * drawCursor(k, j, c)
+ *
+ * Draw (or with GAPCOL erase) the frame around cell k,j, it lives in the gaps.
+*/
+void drawCursor(uint8_t k, uint8_t j, uint8_t c) {
+    uint16_t x0 = mem.cells.x[k] - 1, x1 = mem.cells.x[k] + PEDPW;
+    uint8_t y0 = CELLY(j) - 1, y1 = CELLY(j) + PEDPH;
+
+    fastline(x0, y0, x1, y0, c);
+    fastline(x0, y1, x1, y1, c);
+    fastline(x0, y0, x0, y1, c);
+    fastline(x1, y0, x1, y1, c);
+}
+
+/**
+ * drawGrid()
+ *
+ * Paint every cell of the editor area from the sprite.
+*/
+void drawGrid() {
+    uint8_t j, k;
+
+    memset(mem.cells.shown, 0xff, sizeof(mem.cells.shown)); // screen has been cleared
+
+    for (j = 0; j < PIXH; j++)
+        for (k = 0; k < PIXW; k++)
+            showPixel(k, j);
+}
+
+// Preview of the sprite at its real size, right of the cursor position
+#define PREVX 272 // on a vram byte boundary at any depth
+#define PREVY STATY
+
+/**
+ * previewByte(o, v)
+ *
+ * Show byte o of a packed sprite with the value v in the preview.
+*/
+static void previewByte(uint16_t o, uint8_t v) {
+    uint8_t y = PREVY + o / (PIXW / 2);
+    uint16_t x = PREVX + (o % (PIXW / 2)) * 2;
+
+#if BPP == 4
+    // Same layout as vram so the byte goes straight in
+    RIA_ADDR0 = ((uint16_t)y * STRIDE) + (x >> 1);
+    RIA_RW0 = v;
+    PRF_PIXELS(2);
+    PRF_REGS(2);
+#else
+    setxyc(x, y, (v & 0x0f) ? SHOWCOL(v & 0x0f) : BGCOL);
+    setxyc(x + 1, y, (v >> 4) ? SHOWCOL(v >> 4) : BGCOL);
+#endif
+}
+
+/**
+ * drawPreview(f)
+ *
+ * Show all of frame f in the preview.
+*/
+static void drawPreview(uint8_t f) {
+    uint8_t * b = mem.frames.buf[f];
+#if BPP == 4
+    uint16_t a = ((uint16_t)PREVY * STRIDE) + (PREVX >> 1);
+    uint8_t j, i;
+
+    // A row of the sprite is a row of vram bytes
+    RIA_STEP0 = 1;
+    for (j = 0; j < PIXH; j++) {
+        RIA_ADDR0 = a;
+        for (i = 0; i < PIXW / 2; i++)
+            RIA_RW0 = *b++;
+        a += STRIDE;
+    }
+    PRF_PIXELS(PIXW * PIXH);
+    PRF_REGS(1 + PIXH * (1 + PIXW / 2));
+#else
+    uint16_t o;
+
+    for (o = 0; o < SPRBYTES; o++)
+        previewByte(o, b[o]);
+#endif
+}
+
+/**
+ * buildDelta(i)
+ *
+ * Find the bytes that change from frame i to the next for playback.
+*/
+static void buildDelta(uint8_t i) {
+    uint16_t n = 0, o;
+    uint8_t * a = mem.frames.buf[i], * b = mem.frames.buf[i + 1 < nframes ? i + 1 : 0];
+    uint16_t * d = mem.play.delta[i];
+
+    for (o = 0; o < SPRBYTES; o++) {
+        if (a[o] != b[o]) {
+            if (n == DELTA_STEP)
+                break;
+            d[n++] = o;
+        }
+    }
+    mem.play.len[i] = o < SPRBYTES ? DELTA_FULL : n; // too many, copy the whole frame instead
+    delta_ok |= 1 << i;
+}
+
+/**
+ * playStep()
+ *
+ * Move the preview on to the next frame, only writing the bytes that differ.
+ * That needs the preview to show play_frame, which flushCells() keeps up to date
+ * when that is the frame being drawn on.
+*/
+static void playStep() {
+    uint8_t next = play_frame + 1 < nframes ? play_frame + 1 : 0;
+    uint16_t * d, n;
+    uint8_t * b = mem.frames.buf[next];
+
+    if (!(delta_ok & (1 << play_frame)))
+        buildDelta(play_frame);
+
+    if (mem.play.len[play_frame] == DELTA_FULL) {
+        drawPreview(next);
+    } else {
+        d = mem.play.delta[play_frame];
+        for (n = mem.play.len[play_frame]; n > 0; n--, d++)
+            previewByte(*d, b[*d]);
+    }
+
+    play_frame = next;
+}
+
+static uint8_t cur_x = 0, cur_y = 0; // cursor in sprite pixels
+static uint8_t colour = 1; // colour being painted with
+static uint8_t pen = 0; // 1 paints every cell the cursor moves onto
+
+#define SYM_NONE 0
+#define SYM_H 1 // mirror left/right
+#define SYM_V 2 // mirror top/bottom
+#define SYM_HV 3 // both, four way symmetry
+static uint8_t sym = SYM_NONE;
+static const char * const sym_name[4] = {"OFF", "H  ", "V  ", "HV "};
+
+// Cells waiting to be repainted, a bit per sprite pixel. Edits mark cells here and
+// flushCells() repaints them all at once, so each cell is painted once however
+// many times it was marked and the cursor is redrawn once.
+static uint8_t dirty_any = 0;
+
+/**
+ * markCell(k, j)
+ *
+ * Queue the cell for sprite pixel k,j to be repainted by flushCells().
+*/
+void markCell(uint8_t k, uint8_t j) {
+    mem.cells.dirty[j * (PIXW / 8) + (k >> 3)] |= 1 << (k & 7);
+    mem.cells.dirty_row[j] = 1;
+    dirty_any = 1;
+}
+
+/**
+ * markAll()
+ *
+ * Queue every cell, flushCells() only repaints the ones that look different.
+*/
+void markAll() {
+    memset(mem.cells.dirty, 0xff, sizeof(mem.cells.dirty));
+    memset(mem.cells.dirty_row, 1, sizeof(mem.cells.dirty_row));
+    dirty_any = 1;
+}
+
+/**
+ * flushCells()
+ *
+ * Repaint every marked cell (and the preview unless it is playing another frame) from
+ * the sprite, then the cursor as painting a cell can overwrite the gaps it lives in.
+*/
+void flushCells() {
+    uint8_t j, k, i, b;
+    uint8_t * d = mem.cells.dirty;
+
+    if (!dirty_any)
+        return;
+
+    for (j = 0; j < PIXH; j++) {
+        if (mem.cells.dirty_row[j]) {
+            for (i = 0; i < PIXW / 8; i++) {
+                for (b = d[i], k = i * 8; b; b >>= 1, k++) {
+                    if (b & 1) {
+                        showPixel(k, j);
+                        if (!playing || play_frame == frame)
+                            previewByte(j * (PIXW / 2) + (k >> 1), sprite[j * (PIXW / 2) + (k >> 1)]);
+                    }
+                }
+                d[i] = 0;
+            }
+            mem.cells.dirty_row[j] = 0;
+        }
+        d += PIXW / 8;
+    }
+    dirty_any = 0;
+
+    drawCursor(cur_x, cur_y, CURCOL);
+}
+
+/**
+ * paintSym(x, y, c)
+ *
+ * Set sprite pixel x,y and its mirror images for the symmetry mode to c, marking
+ * their cells. A pixel on a mirror axis is its own image, which is harmless.
+*/
+void paintSym(uint8_t x, uint8_t y, uint8_t c) {
+    uint8_t mx = PIXW - 1 - x, my = PIXH - 1 - y;
+
+    putPixel(x, y, c);
+    markCell(x, y);
+    if (sym & SYM_H) {
+        putPixel(mx, y, c);
+        markCell(mx, y);
+    }
+    if (sym & SYM_V) {
+        putPixel(x, my, c);
+        markCell(x, my);
+    }
+    if (sym == SYM_HV) {
+        putPixel(mx, my, c);
+        markCell(mx, my);
+    }
+}
+
+/**
+ * shapeDot(x, y)
+ *
+ * Add a cell (and its mirror images) to the shape being built in mem.shape.next[].
+ * Anything off the sprite is ignored.
+*/
+static void shapeDot(int8_t x, int8_t y) {
+    uint8_t mx = PIXW - 1 - x, my = PIXH - 1 - y;
+
+    if ((uint8_t)x >= PIXW || (uint8_t)y >= PIXH)
+        return;
+
+    mem.shape.next[y * (PIXW / 8) + (x >> 3)] |= 1 << (x & 7);
+    if (sym & SYM_H)
+        mem.shape.next[y * (PIXW / 8) + (mx >> 3)] |= 1 << (mx & 7);
+    if (sym & SYM_V)
+        mem.shape.next[my * (PIXW / 8) + (x >> 3)] |= 1 << (x & 7);
+    if (sym == SYM_HV)
+        mem.shape.next[my * (PIXW / 8) + (mx >> 3)] |= 1 << (mx & 7);
+}
+
+static void shapeSpan(int8_t x0, int8_t x1, int8_t y) {
+    for (; x0 <= x1; x0++)
+        shapeDot(x0, y);
+}
+
+/**
+ * shapeLine(x0, y0, x1, y1)
+ *
+ * Bresenham line between two cells.
+*/
+static void shapeLine(int8_t x0, int8_t y0, int8_t x1, int8_t y1) {
+    int8_t dx = x1 > x0 ? x1 - x0 : x0 - x1, sx = x0 < x1 ? 1 : -1;
+    int8_t dy = y1 > y0 ? y0 - y1 : y1 - y0, sy = y0 < y1 ? 1 : -1;
+    int16_t err = dx + dy, e2;
+
+    for (;;) {
+        shapeDot(x0, y0);
+        if (x0 == x1 && y0 == y1)
+            break;
+        e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+/**
+ * shapeOval(x0, y0, x1, y1)
+ *
+ * Midpoint ellipse filling the box x0,y0 to x1,y1 (x0 <= x1, y0 <= y1), stepping
+ * round one quadrant and mirroring it. The error terms need more than 16 bits
+ * for the biggest ovals, they are only worked out once a cursor move.
+*/
+static void shapeOval(int8_t x0, int8_t y0, int8_t x1, int8_t y1) {
+    int32_t a = x1 - x0, b = y1 - y0, b1 = b & 1;
+    int32_t dx = 4 * (1 - a) * b * b, dy = 4 * (b1 + 1) * a * a;
+    int32_t err = dx + dy + b1 * a * a, e2;
+
+    y0 += (b + 1) / 2;
+    y1 = y0 - b1;
+    a *= 8 * a;
+    b1 = 8 * b * b;
+
+    do {
+        if (shape_fill) {
+            shapeSpan(x0, x1, y0);
+            shapeSpan(x0, x1, y1);
+        } else {
+            shapeDot(x1, y0);
+            shapeDot(x0, y0);
+            shapeDot(x0, y1);
+            shapeDot(x1, y1);
+        }
+        e2 = 2 * err;
+        if (e2 <= dy) {
+            y0++;
+            y1--;
+            err += dy += a;
+        }
+        if (e2 >= dx || 2 * err > dy) {
+            x0++;
+            x1--;
+            err += dx += b1;
+        }
+    } while (x0 <= x1);
+
+    // Narrow ovals run out of width before reaching the top and bottom of the
+    // box, finish off their tips
+    while (y0 - y1 <= b) {
+        if (shape_fill) {
+            shapeSpan(x0 - 1, x1 + 1, y0);
+            shapeSpan(x0 - 1, x1 + 1, y1);
+        } else {
+            shapeDot(x0 - 1, y0);
+            shapeDot(x1 + 1, y0);
+            shapeDot(x0 - 1, y1);
+            shapeDot(x1 + 1, y1);
+        }
+        y0++;
+        y1--;
+    }
+}
+
+/**
+ * shapeMark(m)
+ *
+ * Queue the cells set in the cell mask m for repainting.
+*/
+static void shapeMark(uint8_t * m) {
+    uint8_t j, i;
+
+    for (j = 0; j < PIXH; j++)
+        for (i = 0; i < PIXW / 8; i++, m++)
+            if (*m) {
+                mem.cells.dirty[j * (PIXW / 8) + i] |= *m;
+                mem.cells.dirty_row[j] = 1;
+                dirty_any = 1;
+            }
+}
+
+/**
+ * shapeUpdate()
+ *
+ * Work out the shape from the anchor to the cursor and queue only the cells that
+ * it newly covers or no longer covers, rather than the whole grid.
+*/
+void shapeUpdate() {
+    int8_t x0 = shape_x < cur_x ? shape_x : cur_x, x1 = shape_x < cur_x ? cur_x : shape_x;
+    int8_t y0 = shape_y < cur_y ? shape_y : cur_y, y1 = shape_y < cur_y ? cur_y : shape_y;
+    uint8_t i;
+
+    memset(mem.shape.next, 0, sizeof(mem.shape.next));
+    switch (shape) {
+    case SHAPE_LINE:
+        shapeLine(shape_x, shape_y, cur_x, cur_y);
+        break;
+    case SHAPE_RECT:
+        if (shape_fill) {
+            for (i = y0; i <= y1; i++)
+                shapeSpan(x0, x1, i);
+        } else {
+            shapeSpan(x0, x1, y0);
+            shapeSpan(x0, x1, y1);
+            for (i = y0 + 1; i < y1; i++) {
+                shapeDot(x0, i);
+                shapeDot(x1, i);
+            }
+        }
+        break;
+    case SHAPE_OVAL:
+        shapeOval(x0, y0, x1, y1);
+        break;
+    }
+
+    // What changed is the new shape xor the old one
+    for (i = 0; i < sizeof(mem.shape.next); i++)
+        mem.shape.mask[i] ^= mem.shape.next[i];
+    shapeMark(mem.shape.mask);
+    memcpy(mem.shape.mask, mem.shape.next, sizeof(mem.shape.mask));
+}
+
+/**
+ * showShape()
+ *
+ * Show the current shape and fill in the status panel.
+*/
+static void showShape() {
+    renderStr((uint8_t *)shape_name[shape], STATX + 32, STATY + 72, 1, FGCOL, BGCOL);
+    renderStr(shape_fill ? "F" : " ", STATX + 56, STATY + 72, 1, FGCOL, BGCOL);
+}
+
+/**
+ * startShape(s)
+ *
+ * Start dragging out shape s from the cursor, or switch to it if one is already
+ * being dragged out.
+*/
+void startShape(uint8_t s) {
+    if (shape == SHAPE_NONE) {
+        shape_x = cur_x;
+        shape_y = cur_y;
+    }
+    shape = s;
+    shape_col = SHOWCOL(colour);
+    shapeMark(mem.shape.mask); // colour may have changed
+    shapeUpdate();
+    showShape();
+}
+
+/**
+ * endShape(keep)
+ *
+ * Paint the shape into the sprite if keep is set, or throw it away.
+*/
+void endShape(uint8_t keep) {
+    uint8_t j, k;
+
+    if (keep)
+        for (j = 0; j < PIXH; j++)
+            for (k = 0; k < PIXW; k++)
+                if (mem.shape.mask[j * (PIXW / 8) + (k >> 3)] & (1 << (k & 7)))
+                    putPixel(k, j, colour);
+    shapeMark(mem.shape.mask);
+    memset(mem.shape.mask, 0, sizeof(mem.shape.mask));
+    shape = SHAPE_NONE;
+    showShape();
+}
+
+
+/**
+ * remapFrames(map, first, n)
+ *
+ * Map every pixel of frames first to first+n-1 through the 16 entry colour map and
+ * count the colours, in one pass over the packed bytes. The nibble map is first
+ * turned into a byte map so each byte costs one lookup rather than splitting and
+ * joining its two pixels, and the bytes (not pixels) are counted so the count
+ * costs one increment too. A map of NULL just counts.
+*/
+void remapFrames(const uint8_t * map, uint8_t first, uint8_t n) {
+    uint8_t * p = mem.frames.buf[first];
+    uint8_t * end = p + n * SPRBYTES;
+    uint8_t i, b;
+
+    memset(mem.remap.count, 0, sizeof(mem.remap.count));
+
+    if (map) {
+        i = 0;
+        do {
+            mem.remap.tab[i] = map[i & 0x0f] | (map[i >> 4] << 4);
+        } while (++i);
+
+        for (; p < end; p++) {
+            b = mem.remap.tab[*p];
+            *p = b;
+            mem.remap.count[b]++;
+        }
+
+        if (n == 1)
+            frameChanged(first);
+        else
+            delta_ok = 0;
+        SAVE_MARK(((1 << n) - 1) << first);
+        if (frame >= first && frame < first + n)
+            markAll();
+        if (playing)
+            drawPreview(play_frame);
+    } else {
+        for (; p < end; p++)
+            mem.remap.count[*p]++;
+    }
+
+    // Fold the byte counts into colour counts, each byte holds two pixels
+    memset(mem.remap.hist, 0, sizeof(mem.remap.hist));
+    i = 0;
+    do {
+        mem.remap.hist[i & 0x0f] += mem.remap.count[i];
+        mem.remap.hist[i >> 4] += mem.remap.count[i];
+    } while (++i);
+}
+
+/**
+ * drawHist()
+ *
+ * Bar chart of the last colour count, scaled so the most used colour fills it.
+*/
+void drawHist() {
+    uint16_t most = 1;
+    uint8_t i, s, h;
+
+    for (i = 0; i < 16; i++)
+        if (mem.remap.hist[i] > most)
+            most = mem.remap.hist[i];
+    for (s = 0; (most >> s) > HISTH; s++)
+        ;
+
+    for (i = 0; i < 16; i++) {
+        h = mem.remap.hist[i] >> s;
+        if (mem.remap.hist[i] && !h)
+            h = 1; // a colour that is used at all shows
+        if (h < HISTH)
+            fbox(HISTX + i * HISTW, HISTY, HISTW, HISTH - h, BGCOL, BGCOL);
+        if (h)
+            fbox(HISTX + i * HISTW, HISTY + HISTH - h, HISTW, h, SHOWCOL(i), BGCOL);
+    }
+}
+
+/**
+ * swapColours(a, b, all)
+ *
+ * Swap two colours in the frame being edited, or in every frame.
+*/
+void swapColours(uint8_t a, uint8_t b, uint8_t all) {
+    uint8_t map[16], i;
+
+    for (i = 0; i < 16; i++)
+        map[i] = i;
+    map[a] = b;
+    map[b] = a;
+
+    if (all)
+        remapFrames(map, 0, nframes);
+    else
+        remapFrames(map, frame, 1);
+    drawHist();
+}
+
+/**
+ * exportFrames(rows)
+ *
+ * Write all frames to SPRITED.BIN ready to be loaded straight into XRAM. They
+ * go one after another, or with rows set row by row (row 0 of every frame, then
+ * row 1 and so on) for blitters that draw all frames of a row together.
+ * Returns 0 if the file couldn't be written.
+*/
+uint8_t exportFrames(uint8_t rows) {
+    int fd;
+    uint8_t f, j, ok = 1;
+
+    if ((fd = open("SPRITED.BIN", O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+        return 0;
+
+    if (rows) {
+        for (j = 0; j < PIXH && ok; j++)
+            for (f = 0; f < nframes && ok; f++)
+                ok = write(fd, mem.frames.buf[f] + j * (PIXW / 2), PIXW / 2) == PIXW / 2;
+    } else {
+        for (f = 0; f < nframes && ok; f++)
+            ok = write(fd, mem.frames.buf[f], SPRBYTES) == SPRBYTES;
+    }
+
+    close(fd);
+    return ok;
+}
+
+/**
+ * showFrame(f)
+ *
+ * Start editing frame f. Only the cells (and preview bytes) that differ from the
+ * frame being left are repainted. With the onion skin on the frames under it
+ * change too, so every cell is checked.
+*/
+void showFrame(uint8_t f) {
+    uint8_t * a = sprite, * b = mem.frames.buf[f];
+    uint16_t o;
+    uint8_t k, j;
+
+    if (onion != ONION_OFF)
+        markAll();
+    else for (o = 0; o < SPRBYTES; o++) {
+        if (a[o] != b[o]) {
+            k = (o % (PIXW / 2)) * 2;
+            j = o / (PIXW / 2);
+            if ((a[o] ^ b[o]) & 0x0f)
+                markCell(k, j);
+            if ((a[o] ^ b[o]) & 0xf0)
+                markCell(k + 1, j);
+        }
+    }
+
+    sprite = b;
+    frame = f;
+}
+
+/**
+ * setPlaying(on)
+ *
+ * Start playback in the preview from the edited frame, or stop it and put the
+ * edited frame back.
+*/
+void setPlaying(uint8_t on) {
+    playing = on;
+    if (on) {
+        play_frame = frame;
+        play_vsync = RIA_VSYNC;
+        play_acc = 0;
+    }
+    drawPreview(frame);
+}
+
+#if AUTOSAVE
+// Each frame is saved to its own file. Writing goes to a temporary file of its
+// own that is only renamed once it is complete, so a crash or reset part way
+// through leaves the last good save in place. FAT can't rename over a file, so
+// the old save is removed first. If a reset comes between the two the complete
+// temporary file is still there and loadFrames() picks it up instead.
+#define SAVE_OK 0
+#define SAVE_BUSY 1
+#define SAVE_ERR 2
+#define SAVE_DIGIT 7 // position of the frame number in save_name and save_tmp
+
+static char save_name[] = "SPRITED0.SPR";
+static char save_tmp[] = "SPRITED0.TMP";
+static const char * const save_state_name[3] = {"OK ", "...", "ERR"};
+static int save_fd = -1; // temporary file being written
+static uint8_t save_frame; // which frame is in it
+static uint16_t save_off; // how much has been written
+static uint8_t save_vsync; // RIA_VSYNC when save_wait was last counted down
+static uint8_t save_state = SAVE_OK;
+static uint8_t save_shown = 0xff; // state on screen, 0xff for none
+
+/**
+ * loadFrame(f)
+ *
+ * Read frame f from its save, or from its temporary file when a save was cut
+ * off after the old file was removed, finishing the rename. Returns 0 if there
+ * is neither.
+*/
+static uint8_t loadFrame(uint8_t f) {
+    uint8_t tmp = 0;
+    int fd, n;
+
+    save_name[SAVE_DIGIT] = save_tmp[SAVE_DIGIT] = '0' + f;
+    if ((fd = open(save_name, O_RDONLY)) < 0) {
+        if ((fd = open(save_tmp, O_RDONLY)) < 0)
+            return 0;
+        tmp = 1;
+    }
+    n = read(fd, mem.frames.buf[f], SPRBYTES);
+    close(fd);
+    if (n != SPRBYTES) { // a temporary file that was never finished
+        memset(mem.frames.buf[f], 0, SPRBYTES);
+        return 0;
+    }
+    if (tmp)
+        rename(save_tmp, save_name);
+    return 1;
+}
+
+/**
+ * loadFrames()
+ *
+ * Pick up the frames saved last time, if there are any. A frame that can't be
+ * found is left empty rather than losing the ones after it.
+*/
+static void loadFrames() {
+    uint8_t f;
+
+    for (f = 0; f < FRAMES; f++)
+        if (loadFrame(f))
+            nframes = f + 1;
+}
+
+/**
+ * saveFailed()
+ *
+ * Put the frame back on the list and try again later, eg. once a drive is plugged in.
+*/
+static void saveFailed() {
+    if (save_fd >= 0) {
+        close(save_fd);
+        save_fd = -1;
+    }
+    save_dirty |= 1 << save_frame;
+    save_wait = AUTOSAVE_WAIT;
+    save_state = SAVE_ERR;
+}
+
+/**
+ * autosave()
+ *
+ * Called when the main loop has no key to deal with. Saving starts once nothing
+ * has changed for AUTOSAVE_WAIT vsyncs, then each call does one small step (open,
+ * AUTOSAVE_BYTES of data, or close and rename) so a key is never kept waiting.
+ * A frame changed while it is being saved is marked again and saved again.
+*/
+static void autosave() {
+    uint8_t f;
+
+    if (save_fd < 0) {
+        if (!save_dirty) {
+            save_state = SAVE_OK;
+            return;
+        }
+        if (save_state != SAVE_ERR)
+            save_state = SAVE_BUSY;
+
+        if (save_wait) {
+            if (RIA_VSYNC != save_vsync) {
+                save_vsync = RIA_VSYNC;
+                save_wait--;
+            }
+            return;
+        }
+
+        for (f = 0; !(save_dirty & (1 << f)); f++)
+            ;
+        save_frame = f;
+        save_off = 0;
+        save_dirty &= ~(1 << f);
+        save_tmp[SAVE_DIGIT] = '0' + f;
+        if ((save_fd = open(save_tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+            saveFailed();
+        return;
+    }
+
+    if (write(save_fd, mem.frames.buf[save_frame] + save_off, AUTOSAVE_BYTES) != AUTOSAVE_BYTES) {
+        saveFailed();
+        return;
+    }
+    save_off += AUTOSAVE_BYTES;
+    if (save_off < SPRBYTES)
+        return;
+
+    close(save_fd);
+    save_fd = -1;
+    save_name[SAVE_DIGIT] = save_tmp[SAVE_DIGIT] = '0' + save_frame;
+    remove(save_name); // rename won't replace a file on FAT
+    if (rename(save_tmp, save_name) != 0)
+        saveFailed();
+    else if (save_state == SAVE_ERR)
+        save_state = SAVE_BUSY;
+}
+
+/**
+ * showSave()
+ *
+ * Update the autosave state in the status panel if it has changed.
+*/
+static void showSave() {
+    if (save_state != save_shown) {
+        save_shown = save_state;
+        renderStr((uint8_t *)save_state_name[save_state], STATX + 32, STATY + 84, 1, FGCOL, BGCOL);
+    }
+}
+#endif
+
+/**
+ * drawLayout()
+ * 
+ * Draw the borders around the different screen areas, static text etc.
+*/
+void drawLayout() {
+    gcls(BGCOL);
+    PRF_REDRAW();
+
+    // Outside border
+    fastline(LB,TB,LB,BB,FGCOL); // vertical line at right
+    fastline(RB,TB,RB,BB,FGCOL); // Vertical line at left
+
+    fastline(LB,TB,RB,TB,FGCOL); // horizontal line at top
+    fastline(LB,BB,RB,BB,FGCOL); // horizontal line at bottom
+
+    renderStr("SPRITE EDITOR BY I.MEINS - JUNE 23", 28, 4, 1, TITLEFG, TITLEBG);
+
+    // bordering box around the 32x32 editor area
+    fastline(PEDX, PEDY, PEDX+PBOXW, PEDY, FGCOL);
+    fastline(PEDX, PEDY, PEDX, PEDY+PBOXH, FGCOL);
+
+    fastline(PEDX, PEDY+PBOXH, PEDX+PBOXW, PEDY+PBOXH, FGCOL);
+    fastline(PEDX+PBOXW, PEDY, PEDX+PBOXW, PEDY+PBOXH, FGCOL);
+
+    drawGrid();
+    drawCursor(cur_x, cur_y, CURCOL);
+
+    // Status panel, the values are filled in by the main loop
+    renderStr("X", STATX, STATY, 1, FGCOL, BGCOL);
+    numField(&mem.stat.x, STATX + 16, STATY, 2, FGCOL, BGCOL);
+    renderStr("Y", STATX + 48, STATY, 1, FGCOL, BGCOL);
+    numField(&mem.stat.y, STATX + 64, STATY, 2, FGCOL, BGCOL);
+    renderStr("COL", STATX, STATY + 12, 1, FGCOL, BGCOL);
+    numField(&mem.stat.col, STATX + 32, STATY + 12, 2, FGCOL, BGCOL);
+    fbox(STATX + 56, STATY + 12, 16, 8, SHOWCOL(colour), SHOWCOL(colour));
+    renderStr("SYM", STATX, STATY + 24, 1, FGCOL, BGCOL);
+    renderStr((uint8_t *)sym_name[sym], STATX + 32, STATY + 24, 1, FGCOL, BGCOL);
+    renderStr("FRM", STATX, STATY + 36, 1, FGCOL, BGCOL);
+    numField(&mem.stat.frame, STATX + 32, STATY + 36, 1, FGCOL, BGCOL);
+    renderStr("/", STATX + 40, STATY + 36, 1, FGCOL, BGCOL);
+    numField(&mem.stat.nframes, STATX + 48, STATY + 36, 1, FGCOL, BGCOL);
+    renderStr("FPS", STATX, STATY + 48, 1, FGCOL, BGCOL);
+    numField(&mem.stat.fps, STATX + 32, STATY + 48, 2, FGCOL, BGCOL);
+    renderStr("ONI", STATX, STATY + 60, 1, FGCOL, BGCOL);
+    renderStr((uint8_t *)onion_name[onion], STATX + 32, STATY + 60, 1, FGCOL, BGCOL);
+    renderStr("SHP", STATX, STATY + 72, 1, FGCOL, BGCOL);
+    showShape();
+    remapFrames(NULL, 0, nframes);
+    drawHist();
+#if AUTOSAVE
+    renderStr("SAV", STATX, STATY + 84, 1, FGCOL, BGCOL);
+    save_shown = 0xff;
+#endif
+
+    // Box around the preview
+    fastline(PREVX - 1, PREVY - 1, PREVX + PIXW, PREVY - 1, FGCOL);
+    fastline(PREVX - 1, PREVY + PIXH, PREVX + PIXW, PREVY + PIXH, FGCOL);
+    fastline(PREVX - 1, PREVY - 1, PREVX - 1, PREVY + PIXH, FGCOL);
+    fastline(PREVX + PIXW, PREVY - 1, PREVX + PIXW, PREVY + PIXH, FGCOL);
+    drawPreview(playing ? play_frame : frame);
+}
+
+/**
+ * moveCursor(dx, dy)
+ *
+ * Move the cursor by one cell (dx,dy are -1, 0 or 1), painting the new cell (and its
+ * mirror images) if the pen is down.
+*/
+void moveCursor(int8_t dx, int8_t dy) {
+    uint8_t x = cur_x + dx, y = cur_y + dy;
+
+    if (x >= PIXW || y >= PIXH) // also catches -1 as 255
+        return;
+
+    drawCursor(cur_x, cur_y, GAPCOL);
+    cur_x = x;
+    cur_y = y;
+    if (shape)
+        shapeUpdate();
+    else if (pen)
+        paintSym(cur_x, cur_y, colour);
+    drawCursor(cur_x, cur_y, CURCOL);
+}
+
+/**
+ * doKey(key)
+ *
+ * Act on one key. Returns 0 when it is time to quit.
+*/
+uint8_t doKey(uint8_t key) {
+    switch (key) {
+    case KEY_UP: case 'w':
+        moveCursor(0, -1);
+        break;
+    case KEY_DOWN: case 's':
+        moveCursor(0, 1);
+        break;
+    case KEY_LEFT: case 'a':
+        moveCursor(-1, 0);
+        break;
+    case KEY_RIGHT: case 'd':
+        moveCursor(1, 0);
+        break;
+    case ' ': // paint, or put the shape down
+        if (shape)
+            endShape(1);
+        else
+            paintSym(cur_x, cur_y, colour);
+        break;
+    case 'l': // start a line, box or oval at the cursor
+        startShape(SHAPE_LINE);
+        break;
+    case 'b':
+        startShape(SHAPE_RECT);
+        break;
+    case 'e':
+        startShape(SHAPE_OVAL);
+        break;
+    case 'f': // filled/outlined shapes
+        shape_fill = !shape_fill;
+        if (shape)
+            shapeUpdate();
+        showShape();
+        break;
+    case 'x': // swap the colour under the cursor and the paint colour, in this frame or all of them
+    case 'X':
+        swapColours(getPixel(cur_x, cur_y), colour, key == 'X');
+        break;
+    case 'h': // colour use across all frames
+        remapFrames(NULL, 0, nframes);
+        drawHist();
+        break;
+    case 'W': // export all frames, one after another or row by row
+    case 'R':
+        renderStr(exportFrames(key == 'R') ? "EXPORTED" : "EXP FAIL", MSGX, MSGY, 1, FGCOL, BGCOL);
+        break;
+    case 'c': // drop the shape
+        if (shape)
+            endShape(0);
+        break;
+    case 'p': // pen up/down for freehand drawing
+        pen = !pen;
+        break;
+    case '[':
+    case ']':
+        colour = (colour + (key == ']' ? 1 : 15)) & 15;
+        fbox(STATX + 56, STATY + 12, 16, 8, SHOWCOL(colour), SHOWCOL(colour));
+        if (shape)
+            startShape(shape); // repaint it in the new colour
+        break;
+    case 'm': // symmetry off, H, V, HV
+        sym = (sym + 1) & 3;
+        renderStr((uint8_t *)sym_name[sym], STATX + 32, STATY + 24, 1, FGCOL, BGCOL);
+        break;
+    case ',': // previous/next frame to edit
+        showFrame(frame ? frame - 1 : nframes - 1);
+        break;
+    case '.':
+        showFrame(frame + 1 < nframes ? frame + 1 : 0);
+        break;
+    case 'n': // new frame after this one, starting as a copy of it
+        if (nframes < FRAMES) {
+            memmove(mem.frames.buf[frame + 2], mem.frames.buf[frame + 1], (nframes - frame - 1) * SPRBYTES);
+            memcpy(mem.frames.buf[frame + 1], sprite, SPRBYTES);
+            nframes++;
+            delta_ok = 0; // every step after this frame has moved
+            frame++;
+            SAVE_MARK((0xff << frame) & ((1 << nframes) - 1)); // this frame and the ones after it moved up
+            sprite = mem.frames.buf[frame]; // same picture, but not the same frames under it
+            if (onion != ONION_OFF)
+                markAll();
+            if (playing)
+                setPlaying(1);
+        }
+        break;
+    case 'o': // onion skin off, previous, previous and next
+        onion = onion == ONION_BOTH ? ONION_OFF : onion + 1;
+        renderStr((uint8_t *)onion_name[onion], STATX + 32, STATY + 60, 1, FGCOL, BGCOL);
+        markAll();
+        break;
+    case 'v': // play/stop the preview
+        setPlaying(!playing);
+        break;
+    case '-':
+    case '=':
+        if (key == '-' && fps > 1)
+            fps--;
+        if (key == '=' && fps < 30)
+            fps++;
+        break;
+    case 'Q':
+        return 0;
+    }
+
+    return 1;
+}
+
+void main()
+{
+    uint8_t key;
+#if AUTOSAVE
+    uint8_t lost;
+#endif
+
+    vmode(VMODE);
+
+#ifdef PROFILE
+    prf_clock = clock();
+    prf_vsync = RIA_VSYNC;
+#endif
+
+    initCells();
+#if AUTOSAVE
+    loadFrames();
+#endif
+    drawLayout();
+
+    for (;;) {
+        key = getKey();
+        if (key && !doKey(key))
+            break;
+#if AUTOSAVE
+        if (!key)
+            autosave();
+#endif
+        flushCells(); // one repaint for everything the key changed
+
+        // Playback runs off vsync, 60 a second. fps is added up for every vsync
+        // and a frame is due each time that passes 60, so any rate plays at its
+        // own speed rather than the nearest divisor of 60. If it has fallen more
+        // than a frame behind the rest is dropped rather than racing to catch up.
+        if (playing && RIA_VSYNC != play_vsync) {
+            play_acc += (uint8_t)(RIA_VSYNC - play_vsync) * fps;
+            play_vsync = RIA_VSYNC;
+            if (play_acc >= 60) {
+                playStep();
+                play_acc = play_acc < 120 ? play_acc - 60 : 0;
+            }
+        }
+
+        renderNum(&mem.stat.x, cur_x);
+        renderNum(&mem.stat.y, cur_y);
+        renderNum(&mem.stat.col, colour);
+        renderNum(&mem.stat.frame, frame + 1);
+        renderNum(&mem.stat.nframes, nframes);
+        renderNum(&mem.stat.fps, fps);
+#if AUTOSAVE
+        showSave();
+#endif
+
+        PRF_HUD();
+    }
+
+#if AUTOSAVE
+    // Finish saving before quitting, without waiting for things to settle. A frame
+    // that failed earlier gets another go as the problem may have been put right
+    // since, only one that fails again is given up on and left marked on screen.
+    lost = 0;
+    save_state = SAVE_BUSY;
+    while (save_dirty || save_fd >= 0) {
+        save_wait = 0;
+        autosave();
+        if (save_state == SAVE_ERR) {
+            lost |= 1 << save_frame;
+            save_dirty &= ~lost;
+            save_state = SAVE_BUSY;
+        }
+    }
+    if (lost) {
+        save_state = SAVE_ERR;
+        showSave();
+        renderStr("NOT SAVED", MSGX, MSGY, 1, FGCOL, BGCOL);
+    }
+#endif
 }
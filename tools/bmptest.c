@@ -0,0 +1,117 @@
+/**
+ * bmptest - checks the BMP loader in sprtool.c reads both row orders
+ *
+ * Usage: bmptest
+ *
+ * Writes a small 24 bit image to the current directory bottom up (positive
+ * height) and top down (negative height), loads both with loadImage() and
+ * checks each gives the same pixels in the same places.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "sprtool.h"
+
+#define W 3
+#define H 2
+#define STRIDE ((W * 3 + 3) & ~3)
+
+// Colour of each pixel, rows top to bottom
+static const unsigned char colours[H][W] = {
+    {9, 10, 12},
+    {11, 14, 15},
+};
+
+static void put32(unsigned char * p, unsigned long v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+/**
+ * writeBmp(path, topdown)
+ *
+ * Write colours[] as an uncompressed 24 bit BMP, rows stored in either order.
+*/
+static int writeBmp(const char * path, int topdown) {
+    unsigned char buf[54 + STRIDE * H], * row;
+    const unsigned char * c;
+    unsigned x, y;
+    FILE * f;
+
+    memset(buf, 0, sizeof(buf));
+    buf[0] = 'B';
+    buf[1] = 'M';
+    put32(buf + 2, sizeof(buf));
+    put32(buf + 10, 54);
+    put32(buf + 14, 40);
+    put32(buf + 18, W);
+    put32(buf + 22, topdown ? (unsigned long)-H : H);
+    buf[26] = 1;
+    buf[28] = 24;
+    put32(buf + 34, STRIDE * H);
+    for (y = 0; y < H; y++) {
+        row = buf + 54 + STRIDE * (topdown ? y : H - 1 - y);
+        for (x = 0; x < W; x++) {
+            c = ansi_palette[colours[y][x]];
+            row[x * 3] = c[2];
+            row[x * 3 + 1] = c[1];
+            row[x * 3 + 2] = c[0];
+        }
+    }
+
+    if ((f = fopen(path, "wb")) == NULL)
+        return -1;
+    if (fwrite(buf, 1, sizeof(buf), f) != sizeof(buf)) {
+        fclose(f);
+        return -1;
+    }
+    return fclose(f);
+}
+
+/**
+ * check(path, topdown)
+ *
+ * Write and load back one row order, counting the pixels that come out wrong.
+*/
+static int check(const char * path, int topdown) {
+    Image img;
+    unsigned x, y;
+    int bad = 0;
+
+    if (writeBmp(path, topdown) != 0) {
+        fprintf(stderr, "bmptest: can't write %s\n", path);
+        return 1;
+    }
+    if (loadImage(path, &img) != 0) {
+        printf("%-8s FAIL not loaded\n", topdown ? "topdown" : "bottomup");
+        remove(path);
+        return 1;
+    }
+    remove(path);
+
+    if (img.w != W || img.h != H) {
+        printf("%-8s FAIL %ux%u, not %ux%u\n", topdown ? "topdown" : "bottomup", img.w, img.h, W, H);
+        bad = 1;
+    } else {
+        for (y = 0; y < H; y++)
+            for (x = 0; x < W; x++)
+                if (quantise(img.rgba + (y * W + x) * 4) != colours[y][x])
+                    bad++;
+        if (bad)
+            printf("%-8s FAIL %d pixels wrong\n", topdown ? "topdown" : "bottomup", bad);
+        else
+            printf("%-8s ok\n", topdown ? "topdown" : "bottomup");
+    }
+    freeImage(&img);
+    return bad != 0;
+}
+
+int main(void) {
+    int failed = 0;
+
+    initQuantise();
+    failed += check("bmptest-up.bmp", 0);
+    failed += check("bmptest-down.bmp", 1);
+    return failed ? 1 : 0;
+}
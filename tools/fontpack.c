@@ -0,0 +1,129 @@
+/**
+ * fontpack - host tool that compresses src/font8x8.h into src/font8x8z.h
+ *
+ * Usage: fontpack > ../src/font8x8z.h
+ *
+ * Every glyph row is replaced by an index into a table of unique rows sorted by
+ * how often they are used. Indices are stored as a nibble stream:
+ *   0-13      row table entry 0-13
+ *   14, n     row table entry 14+n
+ *   15, n     row table entry 30+n
+ * The font only has ~40 different rows so nearly every row costs 4 bits instead
+ * of 8. An offset into the stream is kept for every 16th glyph so the editor can
+ * decode any glyph by skipping at most 15 others.
+ *
+ * Codes 0-31 and 128-255 are not stored, the editor derives them from the 96
+ * stored glyphs (see fontGlyph() in sprited.c).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/font8x8.h"
+
+#define FIRST 32
+#define GLYPHS (sizeof(console_font_8x8) / 8)
+#define BLOCK 16
+#define MAXROWS 46
+
+static unsigned char rows[256];
+static unsigned count[256];
+static unsigned nrows = 0;
+static unsigned char codes[GLYPHS * 8 * 2]; // worst case two nibbles a row
+static unsigned ncodes = 0; // in nibbles
+static unsigned block[(GLYPHS + BLOCK - 1) / BLOCK];
+
+/**
+ * rowIndex(r)
+ *
+ * Position of row bit pattern r in the sorted row table.
+*/
+static unsigned rowIndex(unsigned char r) {
+    unsigned i;
+
+    for (i = 0; i < nrows; i++)
+        if (rows[i] == r)
+            return i;
+
+    fprintf(stderr, "fontpack: row 0x%02X missing\n", r);
+    exit(1);
+}
+
+static void putNibble(unsigned n) {
+    if ((ncodes & 1) == 0)
+        codes[ncodes >> 1] = n << 4;
+    else
+        codes[ncodes >> 1] |= n;
+    ncodes++;
+}
+
+int main(void) {
+    unsigned i, j, t;
+    unsigned char rt;
+
+    // Count how often each row pattern is used
+    for (i = 0; i < GLYPHS * 8; i++)
+        count[console_font_8x8[i]]++;
+
+    for (i = 0; i < 256; i++)
+        if (count[i])
+            rows[nrows++] = i;
+
+    if (nrows > MAXROWS) {
+        fprintf(stderr, "fontpack: %u unique rows, the code scheme only covers %u\n", nrows, MAXROWS);
+        return 1;
+    }
+
+    // Most used rows first so they get the single nibble codes (simple insertion sort)
+    for (i = 1; i < nrows; i++) {
+        rt = rows[i];
+        for (j = i; j > 0 && count[rows[j - 1]] < count[rt]; j--)
+            rows[j] = rows[j - 1];
+        rows[j] = rt;
+    }
+
+    for (i = 0; i < GLYPHS; i++) {
+        if ((i % BLOCK) == 0)
+            block[i / BLOCK] = ncodes;
+
+        for (j = 0; j < 8; j++) {
+            t = rowIndex(console_font_8x8[i * 8 + j]);
+            if (t < 14) {
+                putNibble(t);
+            } else if (t < 30) {
+                putNibble(14);
+                putNibble(t - 14);
+            } else {
+                putNibble(15);
+                putNibble(t - 30);
+            }
+        }
+    }
+
+    printf("/**\n");
+    printf(" * Compressed 8x8 font generated by tools/fontpack from font8x8.h - do not edit.\n");
+    printf(" *\n");
+    printf(" * %u glyphs from ASCII %u, %u bytes packed (%u bytes unpacked).\n",
+        (unsigned)GLYPHS, FIRST,
+        (unsigned)(nrows + sizeof(block) / sizeof(block[0]) * 2 + (ncodes + 1) / 2),
+        (unsigned)sizeof(console_font_8x8));
+    printf("*/\n");
+    printf("#define FONT_FIRST %u\n", FIRST);
+    printf("#define FONT_GLYPHS %u\n", (unsigned)GLYPHS);
+    printf("#define FONT_BLOCK %u\n\n", BLOCK);
+
+    printf("static const unsigned char font_rows[%u] = {", nrows);
+    for (i = 0; i < nrows; i++)
+        printf("%s0x%02X,", (i % 12) ? " " : "\n    ", rows[i]);
+    printf("\n};\n\n");
+
+    printf("static const unsigned int font_block[%u] = {", (unsigned)(sizeof(block) / sizeof(block[0])));
+    for (i = 0; i < sizeof(block) / sizeof(block[0]); i++)
+        printf("%s%u,", i ? " " : "\n    ", block[i]);
+    printf("\n};\n\n");
+
+    printf("static const unsigned char font_codes[%u] = {", (ncodes + 1) / 2);
+    for (i = 0; i < (ncodes + 1) / 2; i++)
+        printf("%s0x%02X,", (i % 12) ? " " : "\n    ", codes[i]);
+    printf("\n};\n");
+
+    return 0;
+}
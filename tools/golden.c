@@ -0,0 +1,249 @@
+/**
+ * golden - checks the editor's drawing against recorded results
+ *
+ * Usage: golden [-u] file
+ *
+ * Each case below draws with one of the primitives in sprited.c (or the whole
+ * screen with drawLayout()) on a cleared emulated framebuffer, see host/rp6502.h.
+ * The file holds a line for every case: its name, a hash of the framebuffer it
+ * should leave and the most RIA register accesses it may take. A case fails if
+ * the picture is different or it takes more accesses than that, so making a
+ * primitive faster can't quietly break it or make something else slower. A case
+ * that got cheaper is reported so the budget can be tightened. The picture a
+ * failing case drew is written to <case>.fail.png in the current directory.
+ *
+ * -u writes the file from the current results instead. Only do that once the
+ * changed pictures have been checked by eye, eg. with replay -p.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "rp6502.h"
+#include "sprtool.h"
+
+#define main sprited_main
+#include "../src/sprited.c"
+#undef main
+
+typedef struct Case {
+    const char * name;
+    void (*draw)(void);
+} Case;
+
+static void caseGcls(void) {
+    gcls(FGCOL);
+}
+
+static void casePlot(void) {
+    uint16_t x;
+
+    for (x = 0; x < 64; x++)
+        setxyc(x * 5, x * 3, x & 15);
+}
+
+static void caseHline(void) {
+    uint8_t i;
+
+    // Every start and end alignment within a byte, short and long
+    for (i = 0; i < 16; i++) {
+        fastline(10 + i, 10 + i, 10 + i + (i & 7), 10 + i, i);
+        fastline(3 + i, 40 + i, 300 - i, 40 + i, 15 - i);
+    }
+}
+
+static void caseVline(void) {
+    uint8_t i;
+
+    for (i = 0; i < 16; i++)
+        fastline(20 + i * 3, 5 + i, 20 + i * 3, 200 - i, i);
+}
+
+static void caseFbox(void) {
+    uint8_t i;
+
+    for (i = 0; i < 8; i++)
+        fbox(10 + i * 37 + (i & 3), 10 + i * 20, 9 + i * 3, 15, i + 1, i + 8);
+}
+
+static void caseClip(void) {
+    setClip(51, 41, 200, 150);
+    fbox(40, 30, 100, 60, FGCOL, BGCOL);
+    fbox(190, 140, 30, 30, 9, 10);
+    fastline(0, 100, 319, 100, 11);
+    fastline(120, 0, 120, 239, 12);
+    renderStr("CLIPPED", 20, 45, 1, FGCOL, BGCOL);
+    renderStr("EDGE", 190, 145, 2, 13, BGCOL);
+    noClip();
+}
+
+static void caseText(void) {
+    // Byte aligned goes through blitGlyph, odd x through render8x8
+    renderStr("THE QUICK BROWN FOX 0123456789", 8, 20, 1, FGCOL, BGCOL);
+    renderStr("jumps over the lazy dog {}[]", 9, 32, 1, TITLEFG, TITLEBG);
+    renderStr("BIG", 40, 60, 3, CURCOL, BGCOL);
+}
+
+static void caseInt(void) {
+    NumField f;
+    uint16_t v;
+
+    renderInt(10, 10, 0, FGCOL, BGCOL);
+    renderInt(10, 20, 65535u, FGCOL, BGCOL);
+    numField(&f, 10, 30, 5, FGCOL, BGCOL);
+    for (v = 1; v < 60000u; v = v * 3 + 7)
+        renderNum(&f, v);
+}
+
+static void caseCells(void) {
+    uint8_t k, j;
+
+    for (j = 0; j < PIXH; j += 3)
+        for (k = 0; k < PIXW; k++)
+            paintCell(k, j, (k + j) & 15);
+}
+
+static void caseLayout(void) {
+    uint8_t k;
+
+    for (k = 0; k < PIXW; k++)
+        putPixel(k, k, k & 15);
+    drawLayout();
+}
+
+static const Case cases[] = {
+    {"gcls", caseGcls},
+    {"setxyc", casePlot},
+    {"hline", caseHline},
+    {"vline", caseVline},
+    {"fbox", caseFbox},
+    {"clip", caseClip},
+    {"text", caseText},
+    {"int", caseInt},
+    {"cells", caseCells},
+    {"layout", caseLayout},
+};
+
+#define NCASES (sizeof(cases) / sizeof(cases[0]))
+
+static uint8_t screens[NCASES][WIDTH * HEIGHT]; // what each case drew, a byte a pixel
+
+/**
+ * grabScreen(pix)
+ *
+ * Unpack the framebuffer into a byte a pixel.
+*/
+static void grabScreen(uint8_t * pix) {
+    uint16_t x, y;
+    uint8_t b;
+
+    for (y = 0; y < HEIGHT; y++)
+        for (x = 0; x < WIDTH; x++) {
+            b = xram[(uint32_t)y * STRIDE + (x >> XSHIFT)];
+            *pix++ = ((b & pix_mask[XPIX(x)]) >> (XPIX(x) * BPP)) & 15;
+        }
+}
+
+/**
+ * writeFailed(i)
+ *
+ * Save the picture case i drew so it can be compared with the expected one.
+*/
+static void writeFailed(unsigned i) {
+    char path[80];
+
+    snprintf(path, sizeof(path), "%s.fail.png", cases[i].name);
+    if (savePng(path, WIDTH, HEIGHT, screens[i]) != 0)
+        fprintf(stderr, "golden: can't write %s\n", path);
+    else
+        printf("%-8s picture written to %s\n", cases[i].name, path);
+}
+
+int main(int argc, char ** argv) {
+    unsigned long hash[NCASES], regs[NCASES], want_hash, want_regs;
+    char name[64];
+    int update = 0, failed = 0, c;
+    unsigned i, found;
+    FILE * f;
+
+    while ((c = getopt(argc, argv, "u")) != -1) {
+        if (c != 'u') {
+            fprintf(stderr, "usage: golden [-u] file\n");
+            return 1;
+        }
+        update = 1;
+    }
+    if (optind + 1 != argc) {
+        fprintf(stderr, "usage: golden [-u] file\n");
+        return 1;
+    }
+
+    initCells();
+    for (i = 0; i < NCASES; i++) {
+        memset(xram, 0, sizeof(xram));
+        noClip();
+        ria.regs = 0;
+        cases[i].draw();
+        regs[i] = ria.regs;
+        hash[i] = xramHash(FBSIZE);
+        grabScreen(screens[i]);
+    }
+
+    if (update) {
+        if ((f = fopen(argv[optind], "w")) == NULL) {
+            fprintf(stderr, "golden: can't write %s\n", argv[optind]);
+            return 1;
+        }
+        fprintf(f, "# case, framebuffer hash, most register accesses for the %ux%u %u bpp build - written by golden -u\n", WIDTH, HEIGHT, BPP);
+        for (i = 0; i < NCASES; i++)
+            fprintf(f, "%-8s %08lx %lu\n", cases[i].name, hash[i], regs[i]);
+        fclose(f);
+        return 0;
+    }
+
+    if ((f = fopen(argv[optind], "r")) == NULL) {
+        fprintf(stderr, "golden: can't read %s\n", argv[optind]);
+        return 1;
+    }
+    found = 0;
+    while (fscanf(f, " %63s", name) == 1) {
+        if (name[0] == '#') {
+            while ((c = fgetc(f)) != EOF && c != '\n')
+                ;
+            continue;
+        }
+        if (fscanf(f, " %lx %lu", &want_hash, &want_regs) != 2) {
+            fprintf(stderr, "golden: bad line for %s\n", name);
+            return 1;
+        }
+        for (i = 0; i < NCASES && strcmp(cases[i].name, name) != 0; i++)
+            ;
+        if (i == NCASES) {
+            printf("%-8s no such case\n", name);
+            failed++;
+            continue;
+        }
+        found++;
+
+        if (hash[i] != want_hash) {
+            printf("%-8s FAIL picture changed (%08lx, was %08lx)\n", name, hash[i], want_hash);
+            writeFailed(i);
+            failed++;
+        } else if (regs[i] > want_regs) {
+            printf("%-8s FAIL %lu register accesses, budget %lu\n", name, regs[i], want_regs);
+            writeFailed(i);
+            failed++;
+        } else if (regs[i] < want_regs) {
+            printf("%-8s ok %lu register accesses, down from %lu\n", name, regs[i], want_regs);
+        } else {
+            printf("%-8s ok %lu register accesses\n", name, regs[i]);
+        }
+    }
+    fclose(f);
+
+    if (found != NCASES) {
+        printf("%lu cases not in %s\n", (unsigned long)(NCASES - found), argv[optind]);
+        failed++;
+    }
+    return failed ? 1 : 0;
+}
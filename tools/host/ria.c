@@ -0,0 +1,79 @@
+/**
+ * ria.c - the emulated RIA behind host/rp6502.h
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "rp6502.h"
+
+#define RX_SIZE 256
+
+Ria ria;
+uint8_t xram[0x10000];
+void (*ria_frame)(void) = NULL;
+
+static uint8_t rx[RX_SIZE];
+static unsigned rx_head = 0, rx_tail = 0;
+
+/**
+ * riaRxReady()
+ *
+ * The editor polls this once a time round its main loop, so it is where a frame
+ * ends and the next begins.
+*/
+uint8_t riaRxReady(void) {
+    ria.vsync++;
+    ria.frames++;
+    if (ria_frame)
+        ria_frame();
+    return rx_head != rx_tail;
+}
+
+uint8_t riaRx(void) {
+    uint8_t c = 0;
+
+    if (rx_head != rx_tail) {
+        c = rx[rx_tail];
+        rx_tail = (rx_tail + 1) % RX_SIZE;
+    }
+    return c;
+}
+
+/**
+ * riaRxPending()
+ *
+ * Whether typed input is still waiting to be read, without it counting as a frame.
+*/
+uint8_t riaRxPending(void) {
+    return rx_head != rx_tail;
+}
+
+/**
+ * riaType(s, n)
+ *
+ * Queue n bytes of keyboard input.
+*/
+void riaType(const uint8_t * s, unsigned n) {
+    while (n--) {
+        if ((rx_head + 1) % RX_SIZE == rx_tail) {
+            fprintf(stderr, "ria: keyboard buffer full\n");
+            exit(1);
+        }
+        rx[rx_head] = *s++;
+        rx_head = (rx_head + 1) % RX_SIZE;
+    }
+}
+
+/**
+ * xramHash(size)
+ *
+ * FNV-1a hash of the first size bytes of XRAM, eg. the framebuffer, so two runs
+ * can be checked for leaving the same picture.
+*/
+unsigned long xramHash(uint32_t size) {
+    unsigned long h = 2166136261UL;
+    uint32_t i;
+
+    for (i = 0; i < size; i++)
+        h = ((h ^ xram[i]) * 16777619UL) & 0xffffffffUL;
+    return h;
+}
@@ -0,0 +1,68 @@
+/**
+ * rp6502.h - just enough of the RP6502 RIA to run sprited.c on a PC
+ *
+ * Stands in for the SDK header when the editor is built by the host tools (see
+ * ria.c). XRAM is a plain array and every access to RW0, ADDR0 or STEP0 is
+ * counted in ria.regs, which is what the editor's drawing costs on the real
+ * machine. Reading the RX status is taken as the start of a new frame of the
+ * main loop: VSYNC moves on one and the tool driving the editor gets a call to
+ * queue input or look at the screen.
+*/
+#ifndef RP6502_H
+#define RP6502_H
+
+#include <stdint.h>
+
+typedef struct Ria {
+    uint16_t addr0;
+    int8_t step0;
+    uint8_t vsync;
+    uint16_t mode; // last xreg() write, the video mode
+    unsigned long regs; // RW0, ADDR0 and STEP0 accesses so far
+    unsigned long frames; // RX status reads so far
+} Ria;
+
+extern Ria ria;
+extern uint8_t xram[0x10000];
+
+// Called at the start of every frame, before the editor looks for a key
+extern void (*ria_frame)(void);
+
+uint8_t riaRxReady(void);
+uint8_t riaRx(void);
+uint8_t riaRxPending(void);
+void riaType(const uint8_t * s, unsigned n);
+unsigned long xramHash(uint32_t size);
+
+static inline uint8_t * riaRw0(void) {
+    uint8_t * p = &xram[ria.addr0];
+
+    ria.addr0 += ria.step0;
+    ria.regs++;
+    return p;
+}
+
+static inline uint16_t * riaAddr0(void) {
+    ria.regs++;
+    return &ria.addr0;
+}
+
+static inline int8_t * riaStep0(void) {
+    ria.regs++;
+    return &ria.step0;
+}
+
+static inline void xreg(uint16_t data, uint8_t channel, uint8_t address) {
+    (void)channel;
+    (void)address;
+    ria.mode = data;
+}
+
+#define RIA_RW0 (*riaRw0())
+#define RIA_ADDR0 (*riaAddr0())
+#define RIA_STEP0 (*riaStep0())
+#define RIA_RX_READY riaRxReady()
+#define RIA_RX riaRx()
+#define RIA_VSYNC (ria.vsync)
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * memmap - prints the editor's memory map
+ *
+ * Usage: memmap [-b budget]
+ *
+ * Builds sprited.c for the host (see host/rp6502.h) only to get at the layout of
+ * its static block, struct Mem, and prints where each part starts and how many
+ * bytes it takes. Build options that change the sizes, eg. BPP, must be given
+ * to the compiler as they would be for the editor. The total is checked against
+ * MEM_BUDGET, the same limit sprited.c won't compile past, or against -b to see
+ * if it would fit a tighter one.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <unistd.h>
+#include "rp6502.h"
+
+#define main sprited_main
+#include "../src/sprited.c"
+#undef main
+
+#define PART(p) {#p, offsetof(Mem, p), sizeof(((Mem *)0)->p)}
+
+static const struct {
+    const char * name;
+    size_t at, size;
+} parts[] = {
+    PART(frames),
+    PART(play),
+    PART(cells),
+    PART(onion),
+    PART(shape),
+    PART(remap),
+    PART(font),
+    PART(stat),
+#ifdef PROFILE
+    PART(prf),
+#endif
+};
+
+int main(int argc, char ** argv) {
+    unsigned long budget = MEM_BUDGET;
+    unsigned i;
+    int c;
+
+    while ((c = getopt(argc, argv, "b:")) != -1) {
+        if (c != 'b') {
+            fprintf(stderr, "usage: memmap [-b budget]\n");
+            return 1;
+        }
+        budget = strtoul(optarg, NULL, 0);
+    }
+
+    printf("part      offset  bytes\n");
+    for (i = 0; i < sizeof(parts) / sizeof(parts[0]); i++)
+        printf("%-8s %7lu %6lu\n", parts[i].name, (unsigned long)parts[i].at, (unsigned long)parts[i].size);
+    printf("total            %6lu of %lu\n", (unsigned long)sizeof(Mem), budget);
+
+    if (sizeof(Mem) > budget) {
+        fprintf(stderr, "memmap: %lu bytes over budget\n", (unsigned long)(sizeof(Mem) - budget));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,317 @@
+/**
+ * replay - runs the editor on a PC against an emulated RIA and plays a script of
+ * key presses into it
+ *
+ * Usage: replay [-n times] [-v] [-p file.png] [-e dir] script
+ *
+ * sprited.c is built in as it is, only with host/rp6502.h in place of the SDK
+ * one. Every time round its main loop the editor looks for a key, and that is
+ * where the next event of the script is typed in once the last one has been
+ * dealt with. An event is a line of the script:
+ *
+ *   key [count]     press a key, count times
+ *   wait frames     type nothing for a number of frames (eg. during playback)
+ *
+ * A key is a single character as typed, or one of up, down, left, right, space.
+ * Anything after a # is a comment. The whole script is played -n times (once if
+ * not given), then the editor is sent Q.
+ *
+ * Register accesses are what the editor's drawing costs on the real machine
+ * (every byte goes through the RIA), so they are counted per event along with
+ * the host time. -v lists every event. At the end the totals are printed with
+ * a hash of the framebuffer, the same workload must always give the same hash.
+ *
+ * -p saves the final screen as a PNG in the ANSI palette the editor's colours
+ * assume, so the UI can be looked at without the hardware. -e saves the screen
+ * after every event in a directory (start.png, then 00000.png and so on) and
+ * lists how many pixels each event changed and where, which shows exactly how
+ * much each key makes the editor redraw.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "rp6502.h"
+#include "sprtool.h"
+
+#define main sprited_main
+#include "../src/sprited.c"
+#undef main
+
+#define MAXEVENTS 4096
+
+typedef struct Event {
+    char name[8];
+    uint8_t keys[4];
+    uint8_t nkeys; // 0 for a wait
+    unsigned frames; // frames to wait
+} Event;
+
+static Event events[MAXEVENTS];
+static unsigned nevents = 0;
+static unsigned times = 1;
+static int verbose = 0;
+
+static unsigned at = 0, pass = 0; // next event to type
+static unsigned waiting = 0; // frames of a wait still to go
+static int started = 0, busy = 0, done = 0;
+static unsigned long ev_regs, ev_frames;
+static struct timespec ev_start;
+
+static unsigned long n_done = 0, max_regs = 0, total_regs = 0, start_regs;
+static char max_name[8];
+static double total_us = 0;
+
+static const char * shot_file = NULL, * shot_dir = NULL;
+static uint8_t screen[WIDTH * HEIGHT], last_screen[WIDTH * HEIGHT]; // a byte a pixel
+static unsigned long total_changed = 0;
+
+/**
+ * grabScreen(pix)
+ *
+ * Unpack the framebuffer into a byte a pixel.
+*/
+static void grabScreen(uint8_t * pix) {
+    uint16_t x, y;
+    uint8_t b;
+
+    for (y = 0; y < HEIGHT; y++)
+        for (x = 0; x < WIDTH; x++) {
+            b = xram[(uint32_t)y * STRIDE + (x >> XSHIFT)];
+            *pix++ = ((b & pix_mask[XPIX(x)]) >> (XPIX(x) * BPP)) & 15;
+        }
+}
+
+static void saveScreen(const char * path, const uint8_t * pix) {
+    if (savePng(path, WIDTH, HEIGHT, pix) != 0) {
+        fprintf(stderr, "replay: can't write %s\n", path);
+        exit(1);
+    }
+}
+
+/**
+ * shotEvent(n, changed)
+ *
+ * Save the screen after event n and describe what changed since the last one.
+*/
+static void shotEvent(unsigned long n, char * changed) {
+    char path[1024];
+    unsigned long count = 0;
+    unsigned x, y, x0 = WIDTH, y0 = HEIGHT, x1 = 0, y1 = 0;
+    uint8_t * a = screen, * b = last_screen;
+
+    grabScreen(screen);
+    for (y = 0; y < HEIGHT; y++)
+        for (x = 0; x < WIDTH; x++)
+            if (*a++ != *b++) {
+                count++;
+                if (x < x0) x0 = x;
+                if (x > x1) x1 = x;
+                if (y < y0) y0 = y;
+                if (y > y1) y1 = y;
+            }
+    total_changed += count;
+
+    if (count)
+        sprintf(changed, " %6lu px changed in %u,%u-%u,%u", count, x0, y0, x1, y1);
+    else
+        sprintf(changed, "      0 px changed");
+
+    snprintf(path, sizeof(path), "%s/%05lu.png", shot_dir, n);
+    saveScreen(path, screen);
+    memcpy(last_screen, screen, sizeof(screen));
+}
+
+/**
+ * addEvent(name, count, line)
+ *
+ * Turn a key name from the script into the bytes the terminal would send.
+*/
+static void addEvent(const char * name, unsigned count, unsigned line) {
+    Event e;
+
+    memset(&e, 0, sizeof(e));
+    strncpy(e.name, name, sizeof(e.name) - 1);
+
+    if (strcmp(name, "wait") == 0) {
+        e.frames = count;
+        count = 1;
+    } else if (strcmp(name, "up") == 0 || strcmp(name, "down") == 0
+        || strcmp(name, "right") == 0 || strcmp(name, "left") == 0) {
+        e.keys[0] = 27;
+        e.keys[1] = '[';
+        e.keys[2] = name[0] == 'u' ? 'A' : name[0] == 'd' ? 'B' : name[0] == 'r' ? 'C' : 'D';
+        e.nkeys = 3;
+    } else if (strcmp(name, "space") == 0) {
+        e.keys[0] = ' ';
+        e.nkeys = 1;
+    } else if (strlen(name) == 1) {
+        e.keys[0] = name[0];
+        e.nkeys = 1;
+    } else {
+        fprintf(stderr, "replay: line %u: unknown key %s\n", line, name);
+        exit(1);
+    }
+
+    while (count--) {
+        if (nevents == MAXEVENTS) {
+            fprintf(stderr, "replay: more than %u events\n", MAXEVENTS);
+            exit(1);
+        }
+        events[nevents++] = e;
+    }
+}
+
+static void readScript(const char * path) {
+    FILE * f;
+    char line[256], name[64], * hash;
+    unsigned count, n = 0;
+    int got;
+
+    if ((f = fopen(path, "r")) == NULL) {
+        fprintf(stderr, "replay: can't read %s\n", path);
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), f)) {
+        n++;
+        if ((hash = strchr(line, '#')) != NULL)
+            *hash = 0;
+        got = sscanf(line, " %63s %u", name, &count);
+        if (got >= 1)
+            addEvent(name, got == 2 ? count : 1, n);
+    }
+    fclose(f);
+}
+
+static double usSince(const struct timespec * t0) {
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1e6 + (t1.tv_nsec - t0->tv_nsec) / 1e3;
+}
+
+/**
+ * endEvent()
+ *
+ * The editor has dealt with the last event, note what it cost.
+*/
+static void endEvent(void) {
+    Event * e = &events[at];
+    unsigned long regs = ria.regs - ev_regs;
+    double us = usSince(&ev_start);
+    char changed[64] = "";
+
+    if (shot_dir)
+        shotEvent(n_done, changed);
+    if (verbose || shot_dir)
+        printf("%6lu %-6s %8lu regs %4lu frames %8.1f us%s\n", n_done, e->name, regs, ria.frames - ev_frames, us, changed);
+    if (regs > max_regs) {
+        max_regs = regs;
+        strcpy(max_name, e->name);
+    }
+    total_regs += regs;
+    total_us += us;
+    n_done++;
+
+    busy = 0;
+    if (++at == nevents) {
+        at = 0;
+        pass++;
+    }
+}
+
+/**
+ * nextFrame()
+ *
+ * Called as each frame starts, types the next event once the editor has read
+ * everything from the last one.
+*/
+static void nextFrame(void) {
+    static const uint8_t quit = 'Q';
+    Event * e;
+
+    if (done)
+        return;
+    if (!started) {
+        start_regs = ria.regs; // drawing the screen at start up
+        started = 1;
+        if (shot_dir) {
+            char path[1024];
+
+            grabScreen(last_screen);
+            snprintf(path, sizeof(path), "%s/start.png", shot_dir);
+            saveScreen(path, last_screen);
+        }
+    }
+    if (busy) {
+        if (waiting && --waiting)
+            return;
+        if (riaRxPending())
+            return;
+        endEvent();
+    }
+
+    if (pass == times) {
+        riaType(&quit, 1);
+        done = 1;
+        return;
+    }
+
+    e = &events[at];
+    ev_regs = ria.regs;
+    ev_frames = ria.frames;
+    clock_gettime(CLOCK_MONOTONIC, &ev_start);
+    busy = 1;
+    waiting = e->frames;
+    riaType(e->keys, e->nkeys);
+}
+
+int main(int argc, char ** argv) {
+    int c;
+
+    while ((c = getopt(argc, argv, "n:vp:e:")) != -1) {
+        switch (c) {
+        case 'n':
+            times = atoi(optarg);
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case 'p':
+            shot_file = optarg;
+            break;
+        case 'e':
+            shot_dir = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: replay [-n times] [-v] [-p file.png] [-e dir] script\n");
+            return 1;
+        }
+    }
+    if (optind + 1 != argc) {
+        fprintf(stderr, "usage: replay [-n times] [-v] [-p file.png] [-e dir] script\n");
+        return 1;
+    }
+
+    readScript(argv[optind]);
+    if (nevents == 0)
+        times = 0;
+
+    ria_frame = nextFrame;
+    sprited_main();
+
+    printf("%lu events, %lu frames\n", n_done, ria.frames);
+    printf("regs: %lu startup, %lu events, %.1f an event, most %lu (%s)\n",
+        start_regs, total_regs, n_done ? (double)total_regs / n_done : 0.0, max_regs, max_name);
+    printf("host: %.0f us events, %.2f us an event\n", total_us, n_done ? total_us / n_done : 0.0);
+    if (shot_dir)
+        printf("screen: %lu px changed, %.1f an event\n", total_changed, n_done ? (double)total_changed / n_done : 0.0);
+    printf("framebuffer hash: %08lx\n", xramHash(FBSIZE));
+
+    if (shot_file) {
+        grabScreen(screen);
+        saveScreen(shot_file, screen);
+    }
+    return 0;
+}
@@ -0,0 +1,296 @@
+/**
+ * sprconv - host tool that converts PNG and BMP images into packed 4bpp sprites
+ *
+ * Usage: sprconv [-j threads] [-o outdir] [-q] file|directory ...
+ *
+ * Every image becomes a .spr file of the same name holding its 32x32 sprites,
+ * left to right and top to bottom, in the format the editor keeps in memory
+ * (see sprtool.h). Directories are searched (not recursively) for .png and .bmp
+ * files. Files are shared out between worker threads, one thread a core unless
+ * -j says otherwise, and each writes its sprites out as they are packed. At the
+ * end the number of sprites converted a second is reported.
+ *
+ * Two images that would give the same .spr file (eg. with -o, a.png from two
+ * directories) are refused before anything is converted, as two threads would
+ * otherwise write the same file at once.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "sprtool.h"
+
+#define MAXTHREADS 64
+
+static char ** files = NULL;
+static char ** outs = NULL; // .spr file for each of files[]
+static unsigned nfiles = 0, maxfiles = 0;
+static const char * outdir = NULL;
+static int quiet = 0;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned next_file = 0; // next one for a worker to pick up, under lock
+
+typedef struct Worker {
+    pthread_t thread;
+    unsigned long sprites;
+    unsigned long bytes;
+    unsigned failed;
+} Worker;
+
+static void addFile(const char * dir, const char * name) {
+    char * path;
+
+    if (nfiles == maxfiles) {
+        maxfiles = maxfiles ? maxfiles * 2 : 64;
+        if ((files = realloc(files, maxfiles * sizeof(files[0]))) == NULL) {
+            fprintf(stderr, "sprconv: out of memory\n");
+            exit(1);
+        }
+    }
+    if ((path = malloc(strlen(dir) + strlen(name) + 2)) == NULL) {
+        fprintf(stderr, "sprconv: out of memory\n");
+        exit(1);
+    }
+    sprintf(path, "%s%s%s", dir, *dir ? "/" : "", name);
+    files[nfiles++] = path;
+}
+
+/**
+ * isImage(name)
+ *
+ * Whether a directory entry looks like something we convert.
+*/
+static int isImage(const char * name) {
+    const char * dot = strrchr(name, '.');
+
+    return dot != NULL && (strcasecmp(dot, ".png") == 0 || strcasecmp(dot, ".bmp") == 0);
+}
+
+/**
+ * addArg(arg)
+ *
+ * Queue a file, or the images in a directory.
+*/
+static void addArg(const char * arg) {
+    struct stat st;
+    DIR * d;
+    struct dirent * e;
+
+    if (stat(arg, &st) == 0 && S_ISDIR(st.st_mode)) {
+        if ((d = opendir(arg)) == NULL) {
+            fprintf(stderr, "sprconv: can't read %s\n", arg);
+            return;
+        }
+        while ((e = readdir(d)) != NULL)
+            if (isImage(e->d_name))
+                addFile(arg, e->d_name);
+        closedir(d);
+    } else {
+        addFile("", arg);
+    }
+}
+
+/**
+ * outName(path)
+ *
+ * Name of the .spr file for an image, in outdir if one was given.
+*/
+static char * outName(const char * path) {
+    const char * base = strrchr(path, '/');
+    const char * dot;
+    char * out;
+    size_t dlen, blen;
+
+    base = outdir && base ? base + 1 : path;
+    dot = strrchr(base, '.');
+    blen = dot && !strchr(dot, '/') ? (size_t)(dot - base) : strlen(base);
+    dlen = outdir ? strlen(outdir) + 1 : 0;
+
+    if ((out = malloc(dlen + blen + 5)) == NULL)
+        return NULL;
+    if (outdir)
+        sprintf(out, "%s/", outdir);
+    memcpy(out + dlen, base, blen);
+    strcpy(out + dlen + blen, ".spr");
+    return out;
+}
+
+static int cmpOut(const void * a, const void * b) {
+    return strcmp(outs[*(const unsigned *)a], outs[*(const unsigned *)b]);
+}
+
+/**
+ * nameOutputs()
+ *
+ * Work out every output name and check no two images share one. Returns the
+ * number of clashes, which are reported.
+*/
+static unsigned nameOutputs(void) {
+    unsigned * order, i, clashes = 0;
+
+    if ((outs = malloc(nfiles * sizeof(outs[0]))) == NULL
+        || (order = malloc(nfiles * sizeof(order[0]))) == NULL) {
+        fprintf(stderr, "sprconv: out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < nfiles; i++) {
+        if ((outs[i] = outName(files[i])) == NULL) {
+            fprintf(stderr, "sprconv: out of memory\n");
+            exit(1);
+        }
+        order[i] = i;
+    }
+
+    // Sorted by name any clashes are next to each other
+    qsort(order, nfiles, sizeof(order[0]), cmpOut);
+    for (i = 1; i < nfiles; i++)
+        if (strcmp(outs[order[i - 1]], outs[order[i]]) == 0) {
+            fprintf(stderr, "sprconv: %s and %s would both be written to %s\n",
+                files[order[i - 1]], files[order[i]], outs[order[i]]);
+            clashes++;
+        }
+
+    free(order);
+    return clashes;
+}
+
+/**
+ * convert(path, out, w)
+ *
+ * Convert one image, adding what was written to the worker's totals.
+*/
+static void convert(const char * path, const char * out, Worker * w) {
+    Image img;
+    unsigned char spr[SPR_BYTES];
+    unsigned x, y, n;
+    FILE * f;
+
+    if (loadImage(path, &img) != 0) {
+        fprintf(stderr, "sprconv: can't load %s\n", path);
+        w->failed++;
+        return;
+    }
+
+    if ((f = fopen(out, "wb")) == NULL) {
+        fprintf(stderr, "sprconv: can't create %s\n", out);
+        freeImage(&img);
+        w->failed++;
+        return;
+    }
+
+    n = 0;
+    for (y = 0; y < img.h; y += SPR_H)
+        for (x = 0; x < img.w; x += SPR_W) {
+            packSprite(&img, x, y, spr);
+            fwrite(spr, 1, SPR_BYTES, f);
+            n++;
+        }
+
+    if (ferror(f) | fclose(f)) {
+        fprintf(stderr, "sprconv: error writing %s\n", out);
+        remove(out);
+        w->failed++;
+    } else {
+        w->sprites += n;
+        w->bytes += (unsigned long)n * SPR_BYTES;
+        if (!quiet)
+            printf("%s: %ux%u, %u sprites\n", out, img.w, img.h, n);
+    }
+
+    freeImage(&img);
+}
+
+static void * work(void * arg) {
+    Worker * w = arg;
+    unsigned i;
+
+    for (;;) {
+        pthread_mutex_lock(&lock);
+        i = next_file++;
+        pthread_mutex_unlock(&lock);
+        if (i >= nfiles)
+            return NULL;
+        convert(files[i], outs[i], w);
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: sprconv [-j threads] [-o outdir] [-q] file|directory ...\n");
+    exit(1);
+}
+
+int main(int argc, char ** argv) {
+    Worker workers[MAXTHREADS];
+    unsigned long sprites = 0, bytes = 0;
+    unsigned failed = 0;
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    struct timespec t0, t1;
+    double secs;
+    int c, i;
+
+    while ((c = getopt(argc, argv, "j:o:q")) != -1) {
+        switch (c) {
+        case 'j':
+            nthreads = atol(optarg);
+            break;
+        case 'o':
+            outdir = optarg;
+            break;
+        case 'q':
+            quiet = 1;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind == argc)
+        usage();
+
+    for (i = optind; i < argc; i++)
+        addArg(argv[i]);
+    if (nfiles == 0) {
+        fprintf(stderr, "sprconv: no images found\n");
+        return 1;
+    }
+    if (nameOutputs() != 0)
+        return 1;
+
+    if (nthreads < 1)
+        nthreads = 1;
+    if (nthreads > MAXTHREADS)
+        nthreads = MAXTHREADS;
+    if ((unsigned long)nthreads > nfiles)
+        nthreads = nfiles;
+
+    initQuantise();
+    memset(workers, 0, sizeof(workers));
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    for (i = 0; i < nthreads; i++)
+        if (pthread_create(&workers[i].thread, NULL, work, &workers[i]) != 0) {
+            fprintf(stderr, "sprconv: can't start thread\n");
+            return 1;
+        }
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        sprites += workers[i].sprites;
+        bytes += workers[i].bytes;
+        failed += workers[i].failed;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    if (secs <= 0)
+        secs = 1e-9;
+
+    fprintf(stderr, "sprconv: %u files, %lu sprites, %lu bytes in %.3fs on %ld threads (%.0f sprites/s)\n",
+        nfiles - failed, sprites, bytes, secs, nthreads, sprites / secs);
+
+    return failed ? 1 : 0;
+}
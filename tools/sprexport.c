@@ -0,0 +1,172 @@
+/**
+ * sprexport - host tool that turns sprites into data for a game
+ *
+ * Usage: sprexport [-f bin|c|asm] [-r] [-n name] -o out file ...
+ *
+ * The inputs are .spr files (as saved or exported by the editor, or made by
+ * sprconv) or PNG/BMP images, all their sprites are taken in order. The output
+ * is one of:
+ *
+ *   bin  the sprites as they are in XRAM, to be loaded with one bulk copy
+ *   c    a const array for cc65 with the count and size as #defines
+ *   asm  a ca65 .rodata table exported as _name so C can use it too
+ *
+ * Sprites are packed 4 bits a pixel with the even x in the low nibble, 16 bytes
+ * a row, one sprite after another. With -r the rows are interleaved instead:
+ * row 0 of every sprite, then row 1 and so on, for blitters that step through
+ * all the frames of a row together. The editor's W and R keys write the same
+ * two layouts.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include "sprtool.h"
+
+#define FMT_BIN 0
+#define FMT_C 1
+#define FMT_ASM 2
+
+#define ROW (SPR_W / 2)
+
+static unsigned char * sprites = NULL;
+static unsigned long nsprites = 0;
+
+static void usage(void) {
+    fprintf(stderr, "usage: sprexport [-f bin|c|asm] [-r] [-n name] -o out file ...\n");
+    exit(1);
+}
+
+/**
+ * interleave()
+ *
+ * Reorder the sprites row by row.
+*/
+static void interleave(void) {
+    unsigned char * out = malloc(nsprites * SPR_BYTES), * p = out;
+    unsigned long s;
+    unsigned r;
+
+    if (out == NULL) {
+        fprintf(stderr, "sprexport: out of memory\n");
+        exit(1);
+    }
+    for (r = 0; r < SPR_H; r++)
+        for (s = 0; s < nsprites; s++, p += ROW)
+            memcpy(p, sprites + s * SPR_BYTES + r * ROW, ROW);
+    free(sprites);
+    sprites = out;
+}
+
+int main(int argc, char ** argv) {
+    const char * out = NULL, * name = "sprites";
+    char upper[64];
+    int fmt = FMT_BIN, rows = 0, c, i;
+    unsigned char * spr;
+    unsigned long n, size, b;
+    FILE * f;
+
+    while ((c = getopt(argc, argv, "f:rn:o:")) != -1) {
+        switch (c) {
+        case 'f':
+            if (strcmp(optarg, "bin") == 0)
+                fmt = FMT_BIN;
+            else if (strcmp(optarg, "c") == 0)
+                fmt = FMT_C;
+            else if (strcmp(optarg, "asm") == 0)
+                fmt = FMT_ASM;
+            else
+                usage();
+            break;
+        case 'r':
+            rows = 1;
+            break;
+        case 'n':
+            name = optarg;
+            break;
+        case 'o':
+            out = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (out == NULL || optind == argc)
+        usage();
+
+    if (strlen(name) >= sizeof(upper)) {
+        fprintf(stderr, "sprexport: name %s is longer than %u characters\n", name, (unsigned)sizeof(upper) - 1);
+        return 1;
+    }
+    for (i = 0; name[i]; i++) {
+        if ((!isalnum((unsigned char)name[i]) && name[i] != '_') || (i == 0 && isdigit((unsigned char)name[i]))) {
+            fprintf(stderr, "sprexport: %s isn't a C name\n", name);
+            return 1;
+        }
+        upper[i] = toupper((unsigned char)name[i]);
+    }
+    if (i == 0) {
+        fprintf(stderr, "sprexport: the name can't be empty\n");
+        return 1;
+    }
+    upper[i] = 0;
+
+    initQuantise();
+    for (i = optind; i < argc; i++) {
+        if ((spr = loadSprites(argv[i], &n)) == NULL) {
+            fprintf(stderr, "sprexport: can't read %s\n", argv[i]);
+            return 1;
+        }
+        if ((sprites = realloc(sprites, (nsprites + n) * SPR_BYTES)) == NULL) {
+            fprintf(stderr, "sprexport: out of memory\n");
+            return 1;
+        }
+        memcpy(sprites + nsprites * SPR_BYTES, spr, n * SPR_BYTES);
+        nsprites += n;
+        free(spr);
+    }
+    if (nsprites == 0) {
+        fprintf(stderr, "sprexport: no sprites\n");
+        return 1;
+    }
+    if (rows)
+        interleave();
+    size = nsprites * SPR_BYTES;
+
+    if ((f = fopen(out, fmt == FMT_BIN ? "wb" : "w")) == NULL) {
+        fprintf(stderr, "sprexport: can't create %s\n", out);
+        return 1;
+    }
+
+    if (fmt == FMT_BIN) {
+        fwrite(sprites, 1, size, f);
+    } else if (fmt == FMT_C) {
+        fprintf(f, "/**\n");
+        fprintf(f, " * %lu %ux%u sprites, 4 bits a pixel, %s - generated by sprexport, do not edit.\n",
+            nsprites, SPR_W, SPR_H, rows ? "rows interleaved" : "one after another");
+        fprintf(f, "*/\n");
+        fprintf(f, "#define %s_COUNT %lu\n", upper, nsprites);
+        fprintf(f, "#define %s_BYTES %lu\n\n", upper, size);
+        fprintf(f, "static const unsigned char %s[%lu] = {", name, size);
+        for (b = 0; b < size; b++)
+            fprintf(f, "%s0x%02X,", (b % ROW) ? " " : "\n    ", sprites[b]);
+        fprintf(f, "\n};\n");
+    } else {
+        fprintf(f, "; %lu %ux%u sprites, 4 bits a pixel, %s - generated by sprexport, do not edit.\n\n",
+            nsprites, SPR_W, SPR_H, rows ? "rows interleaved" : "one after another");
+        fprintf(f, "%s_COUNT = %lu\n", upper, nsprites);
+        fprintf(f, "%s_BYTES = %lu\n\n", upper, size);
+        fprintf(f, ".export _%s\n\n.rodata\n\n_%s:", name, name);
+        for (b = 0; b < size; b++)
+            fprintf(f, "%s$%02X", (b % ROW) ? "," : "\n    .byte ", sprites[b]);
+        fprintf(f, "\n");
+    }
+
+    if (ferror(f) | fclose(f)) {
+        fprintf(stderr, "sprexport: error writing %s\n", out);
+        return 1;
+    }
+    printf("%s: %lu sprites, %lu bytes\n", out, nsprites, size);
+    return 0;
+}
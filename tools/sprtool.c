@@ -0,0 +1,301 @@
+/**
+ * sprtool.c - image loading and saving, and 4bpp packing, shared by the host side tools
+ *
+ * PNG goes through libpng, BMP (uncompressed 1, 4, 8, 24 and 32 bit) is read
+ * here. Colours are matched to the ANSI palette through a table indexed by the
+ * top 5 bits of red, green and blue, so converting a pixel is one lookup.
+ * Pixels less than half opaque become colour 0, which the editor treats as
+ * transparent. Black is colour 0 as well so it comes out transparent too.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <png.h>
+#include "sprtool.h"
+
+const unsigned char ansi_palette[16][3] = {
+    {0x00, 0x00, 0x00}, {0x80, 0x00, 0x00}, {0x00, 0x80, 0x00}, {0x80, 0x80, 0x00},
+    {0x00, 0x00, 0x80}, {0x80, 0x00, 0x80}, {0x00, 0x80, 0x80}, {0xC0, 0xC0, 0xC0},
+    {0x80, 0x80, 0x80}, {0xFF, 0x00, 0x00}, {0x00, 0xFF, 0x00}, {0xFF, 0xFF, 0x00},
+    {0x00, 0x00, 0xFF}, {0xFF, 0x00, 0xFF}, {0x00, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF},
+};
+
+static unsigned char nearest[32 * 32 * 32];
+
+/**
+ * initQuantise()
+ *
+ * Fill the RGB555 to palette table. Must be called before any threads start.
+*/
+void initQuantise(void) {
+    unsigned r, g, b, i, best;
+    long d, dr, dg, db, bestd;
+
+    for (r = 0; r < 32; r++)
+        for (g = 0; g < 32; g++)
+            for (b = 0; b < 32; b++) {
+                best = 0;
+                bestd = 0x7fffffffL;
+                for (i = 0; i < 16; i++) {
+                    dr = (long)(r << 3 | 4) - ansi_palette[i][0];
+                    dg = (long)(g << 3 | 4) - ansi_palette[i][1];
+                    db = (long)(b << 3 | 4) - ansi_palette[i][2];
+                    d = dr * dr + dg * dg + db * db;
+                    if (d < bestd) {
+                        bestd = d;
+                        best = i;
+                    }
+                }
+                nearest[r << 10 | g << 5 | b] = best;
+            }
+}
+
+/**
+ * quantise(rgba)
+ *
+ * Palette colour for one RGBA pixel.
+*/
+unsigned char quantise(const unsigned char * rgba) {
+    if (rgba[3] < 128)
+        return 0;
+    return nearest[(rgba[0] >> 3) << 10 | (rgba[1] >> 3) << 5 | (rgba[2] >> 3)];
+}
+
+static unsigned long le16(const unsigned char * p) {
+    return p[0] | (unsigned long)p[1] << 8;
+}
+
+static unsigned long le32(const unsigned char * p) {
+    return le16(p) | le16(p + 2) << 16;
+}
+
+/**
+ * loadBmp(path, img)
+ *
+ * Uncompressed Windows bitmaps, bottom up or top down.
+*/
+static int loadBmp(const char * path, Image * img) {
+    FILE * f;
+    unsigned char * buf = NULL;
+    const unsigned char * row, * pal, * p;
+    long size;
+    unsigned long off, hsize, comp, ncols, stride;
+    long w, h;
+    unsigned bpp, x, y, v, flip, alpha = 0;
+    unsigned char * out;
+
+    if ((f = fopen(path, "rb")) == NULL)
+        return -1;
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 54 && fseek(f, 0, SEEK_SET) == 0
+        && (buf = malloc(size)) != NULL && fread(buf, 1, size, f) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    if (buf == NULL)
+        return -1;
+
+    off = le32(buf + 10);
+    hsize = le32(buf + 14);
+    w = (int32_t)le32(buf + 18);
+    h = (int32_t)le32(buf + 22); // negative for top down
+    bpp = le16(buf + 28);
+    comp = le32(buf + 30);
+    ncols = le32(buf + 46);
+    flip = h > 0;
+    if (h < 0)
+        h = -h;
+    stride = ((unsigned long)w * bpp + 31) / 32 * 4;
+    if (ncols == 0 && bpp <= 8)
+        ncols = 1u << bpp;
+    pal = buf + 14 + hsize;
+
+    if (buf[0] != 'B' || buf[1] != 'M' || hsize < 40 || w <= 0 || h == 0
+        || (comp != 0 && !(comp == 3 && bpp == 32))
+        || (bpp != 1 && bpp != 4 && bpp != 8 && bpp != 24 && bpp != 32)
+        || (bpp <= 8 && (unsigned long)(pal - buf) + ncols * 4 > (unsigned long)size)
+        || off + stride * h > (unsigned long)size) {
+        free(buf);
+        return -1;
+    }
+
+    img->w = w;
+    img->h = h;
+    if ((img->rgba = out = malloc((size_t)w * h * 4)) == NULL) {
+        free(buf);
+        return -1;
+    }
+
+    for (y = 0; y < img->h; y++) {
+        row = buf + off + stride * (flip ? img->h - 1 - y : y);
+        for (x = 0; x < img->w; x++, out += 4) {
+            if (bpp <= 8) {
+                v = (row[x * bpp / 8] >> (8 - bpp - x * bpp % 8)) & ((1 << bpp) - 1);
+                p = pal + (v < ncols ? v : 0) * 4;
+                out[3] = 255;
+            } else {
+                p = row + x * (bpp / 8);
+                out[3] = bpp == 32 ? p[3] : 255;
+                alpha |= out[3];
+            }
+            out[0] = p[2];
+            out[1] = p[1];
+            out[2] = p[0];
+        }
+    }
+
+    // Plenty of 32 bit bitmaps leave the fourth byte at 0, take those as opaque
+    if (bpp == 32 && alpha == 0)
+        for (x = 0; x < img->w * img->h; x++)
+            img->rgba[x * 4 + 3] = 255;
+
+    free(buf);
+    return 0;
+}
+
+/**
+ * loadPng(path, img)
+*/
+static int loadPng(const char * path, Image * img) {
+    png_image png;
+
+    memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&png, path))
+        return -1;
+
+    png.format = PNG_FORMAT_RGBA;
+    img->w = png.width;
+    img->h = png.height;
+    if ((img->rgba = malloc(PNG_IMAGE_SIZE(png))) == NULL) {
+        png_image_free(&png);
+        return -1;
+    }
+    if (!png_image_finish_read(&png, NULL, img->rgba, 0, NULL)) {
+        freeImage(img);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * loadImage(path, img)
+ *
+ * Load a PNG or BMP as RGBA, picked by the first bytes of the file. Returns 0 or
+ * -1 if the file can't be read or isn't a format we handle.
+*/
+int loadImage(const char * path, Image * img) {
+    FILE * f;
+    unsigned char sig[2] = {0, 0};
+
+    img->rgba = NULL;
+    if ((f = fopen(path, "rb")) == NULL)
+        return -1;
+    if (fread(sig, 1, 2, f) != 2)
+        sig[0] = 0; // too short to be either
+    fclose(f);
+
+    if (sig[0] == 'B' && sig[1] == 'M')
+        return loadBmp(path, img);
+    if (sig[0] == 0x89 && sig[1] == 'P')
+        return loadPng(path, img);
+    return -1;
+}
+
+void freeImage(Image * img) {
+    free(img->rgba);
+    img->rgba = NULL;
+}
+
+/**
+ * spriteCount(img)
+ *
+ * Sprites the image cuts into, left to right and top to bottom. A part sprite at
+ * the right or bottom edge counts as a whole one.
+*/
+unsigned spriteCount(const Image * img) {
+    return ((img->w + SPR_W - 1) / SPR_W) * ((img->h + SPR_H - 1) / SPR_H);
+}
+
+/**
+ * packSprite(img, x0, y0, spr)
+ *
+ * Quantise and pack the sprite with its top left corner at x0,y0 into spr.
+ * Anything past the edge of the image is transparent.
+*/
+void packSprite(const Image * img, unsigned x0, unsigned y0, unsigned char * spr) {
+    const unsigned char * p;
+    unsigned x, y, lo, hi;
+
+    for (y = 0; y < SPR_H; y++) {
+        if (y0 + y >= img->h) {
+            memset(spr, 0, SPR_W / 2);
+            spr += SPR_W / 2;
+            continue;
+        }
+        p = img->rgba + ((size_t)(y0 + y) * img->w + x0) * 4;
+        for (x = 0; x < SPR_W; x += 2, p += 8) {
+            lo = x0 + x < img->w ? quantise(p) : 0;
+            hi = x0 + x + 1 < img->w ? quantise(p + 4) : 0;
+            *spr++ = lo | hi << 4;
+        }
+    }
+}
+
+/**
+ * loadSprites(path, n)
+ *
+ * All the sprites in an image, or in a .spr file if it isn't one, in a malloc'd
+ * buffer. Their number goes in n. NULL if the file can't be read or a .spr file
+ * isn't a whole number of sprites.
+*/
+unsigned char * loadSprites(const char * path, unsigned long * n) {
+    Image img;
+    unsigned char * spr = NULL;
+    unsigned x, y;
+    long size;
+    FILE * f;
+
+    *n = 0;
+    if (loadImage(path, &img) == 0) {
+        if ((spr = malloc((size_t)spriteCount(&img) * SPR_BYTES)) != NULL)
+            for (y = 0; y < img.h; y += SPR_H)
+                for (x = 0; x < img.w; x += SPR_W)
+                    packSprite(&img, x, y, spr + (*n)++ * SPR_BYTES);
+        freeImage(&img);
+        return spr;
+    }
+
+    if ((f = fopen(path, "rb")) == NULL)
+        return NULL;
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 && size % SPR_BYTES == 0
+        && fseek(f, 0, SEEK_SET) == 0 && (spr = malloc(size)) != NULL) {
+        if (fread(spr, 1, size, f) == (size_t)size) {
+            *n = size / SPR_BYTES;
+        } else {
+            free(spr);
+            spr = NULL;
+        }
+    }
+    fclose(f);
+    return spr;
+}
+
+/**
+ * savePng(path, w, h, pix)
+ *
+ * Write w x h pixels of ANSI palette colours, a byte each, as a paletted PNG.
+ * Returns 0 or -1.
+*/
+int savePng(const char * path, unsigned w, unsigned h, const unsigned char * pix) {
+    png_image png;
+
+    memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+    png.width = w;
+    png.height = h;
+    png.format = PNG_FORMAT_RGB_COLORMAP;
+    png.colormap_entries = 16;
+    return png_image_write_to_file(&png, path, 0, pix, w, ansi_palette) ? 0 : -1;
+}
@@ -0,0 +1,34 @@
+/**
+ * sprtool.h - pieces shared by the host side sprite tools
+ *
+ * Sprites are stored the way the editor keeps them in memory: SPR_W x SPR_H
+ * pixels, 4 bits a pixel, two pixels a byte with the even x in the low nibble,
+ * rows top to bottom. A .spr file is any number of these back to back.
+*/
+#ifndef SPRTOOL_H
+#define SPRTOOL_H
+
+#define SPR_W 32 // must match PIXW and PIXH in sprited.c
+#define SPR_H 32
+#define SPR_BYTES (SPR_W * SPR_H / 2)
+
+typedef struct Image {
+    unsigned w, h;
+    unsigned char * rgba; // w * h * 4 bytes, rows top to bottom
+} Image;
+
+// The 16 colour ANSI palette the editor assumes, see BGCOL etc. in sprited.c
+extern const unsigned char ansi_palette[16][3];
+
+void initQuantise(void);
+unsigned char quantise(const unsigned char * rgba);
+
+int loadImage(const char * path, Image * img);
+void freeImage(Image * img);
+int savePng(const char * path, unsigned w, unsigned h, const unsigned char * pix);
+
+void packSprite(const Image * img, unsigned x0, unsigned y0, unsigned char * spr);
+unsigned spriteCount(const Image * img);
+unsigned char * loadSprites(const char * path, unsigned long * n);
+
+#endif
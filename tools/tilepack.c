@@ -0,0 +1,270 @@
+/**
+ * tilepack - host tool that packs sprites into an atlas of unique 8x8 tiles
+ *
+ * Usage: tilepack [-f] [-s WxHxBPP] -o name file ...
+ *
+ * The inputs are .spr files (see sprtool.h) or PNG/BMP images, which are cut
+ * into sprites the same way sprconv does. Every sprite is split into 8x8 tiles
+ * and each tile is looked up in a hash table of the tiles kept so far, with -f
+ * also as its mirror images left/right, top/bottom and both. Only tiles not
+ * seen before go into the atlas. Two files are written, both ready to be copied
+ * into XRAM as they are:
+ *
+ *   name.tiles  the unique tiles, 32 bytes each, 4 bytes a row packed like a
+ *               sprite (even x in the low nibble)
+ *   name.map    for every sprite its tiles left to right and top to bottom, a
+ *               little endian word each: tile number in bits 0-13, bit 14 if it
+ *               is drawn mirrored left/right, bit 15 if top/bottom
+ *
+ * The bytes saved against storing the sprites whole are reported along with how
+ * the result fits in the XRAM beside the editor's framebuffer, 320x240 at 4 bits
+ * a pixel unless -s gives the size and depth it was built with (eg. 320x180x8).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sprtool.h"
+
+#define TILE 8
+#define TILE_ROW (TILE / 2)
+#define TILE_BYTES (TILE * TILE_ROW)
+#define TILES_X (SPR_W / TILE)
+#define TILES_Y (SPR_H / TILE)
+#define MAXTILES 0x4000 // what fits in the map's 14 bits
+
+#define FLIP_X 0x4000
+#define FLIP_Y 0x8000
+
+#define XRAM 0x10000L
+
+static unsigned char * sprites = NULL;
+static unsigned long nsprites = 0, maxsprites = 0;
+
+static unsigned char tiles[MAXTILES][TILE_BYTES];
+static unsigned ntiles = 0;
+static unsigned short * map;
+
+static unsigned * hash_tab; // tile number + 1, 0 for a free slot
+static unsigned long hash_size;
+
+static unsigned char swap_nibbles[256];
+
+/**
+ * addSprites(data, n)
+ *
+ * Append n packed sprites to the input.
+*/
+static void addSprites(const unsigned char * data, unsigned long n) {
+    while (nsprites + n > maxsprites) {
+        maxsprites = maxsprites ? maxsprites * 2 : 256;
+        if ((sprites = realloc(sprites, maxsprites * SPR_BYTES)) == NULL) {
+            fprintf(stderr, "tilepack: out of memory\n");
+            exit(1);
+        }
+    }
+    memcpy(sprites + nsprites * SPR_BYTES, data, n * SPR_BYTES);
+    nsprites += n;
+}
+
+/**
+ * readInput(path)
+ *
+ * Add the sprites from an image or .spr file.
+*/
+static int readInput(const char * path) {
+    unsigned char * spr;
+    unsigned long n;
+
+    if ((spr = loadSprites(path, &n)) == NULL)
+        return -1;
+    addSprites(spr, n);
+    free(spr);
+    return 0;
+}
+
+/**
+ * getTile(spr, tx, ty, t)
+ *
+ * Copy tile tx,ty of a sprite out to t.
+*/
+static void getTile(const unsigned char * spr, unsigned tx, unsigned ty, unsigned char * t) {
+    unsigned r;
+
+    spr += ty * TILE * (SPR_W / 2) + tx * TILE_ROW;
+    for (r = 0; r < TILE; r++, spr += SPR_W / 2, t += TILE_ROW)
+        memcpy(t, spr, TILE_ROW);
+}
+
+/**
+ * flipTile(t, out, flip)
+ *
+ * A mirror image of tile t. Mirroring left/right reverses the bytes of each
+ * row and swaps the two pixels in each byte.
+*/
+static void flipTile(const unsigned char * t, unsigned char * out, unsigned flip) {
+    unsigned r, i;
+    const unsigned char * row;
+
+    for (r = 0; r < TILE; r++, out += TILE_ROW) {
+        row = t + (flip & FLIP_Y ? TILE - 1 - r : r) * TILE_ROW;
+        for (i = 0; i < TILE_ROW; i++)
+            out[i] = flip & FLIP_X ? swap_nibbles[row[TILE_ROW - 1 - i]] : row[i];
+    }
+}
+
+static unsigned long hashTile(const unsigned char * t) {
+    unsigned long h = 2166136261UL; // FNV-1a
+    unsigned i;
+
+    for (i = 0; i < TILE_BYTES; i++)
+        h = ((h ^ t[i]) * 16777619UL) & 0xffffffffUL;
+    return h;
+}
+
+/**
+ * findTile(t)
+ *
+ * Slot in the hash table for tile t, either the one holding it or the free slot
+ * it would go in.
+*/
+static unsigned long findTile(const unsigned char * t) {
+    unsigned long i = hashTile(t) & (hash_size - 1);
+
+    while (hash_tab[i] && memcmp(tiles[hash_tab[i] - 1], t, TILE_BYTES) != 0)
+        i = (i + 1) & (hash_size - 1);
+    return i;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: tilepack [-f] [-s WxHxBPP] -o name file ...\n");
+    exit(1);
+}
+
+static int writeFile(const char * name, const char * ext, const void * data, size_t size) {
+    char path[1024];
+    FILE * f;
+
+    snprintf(path, sizeof(path), "%s%s", name, ext);
+    if ((f = fopen(path, "wb")) == NULL || fwrite(data, 1, size, f) != size || fclose(f) != 0) {
+        fprintf(stderr, "tilepack: error writing %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char ** argv) {
+    const char * name = NULL;
+    int flips = 0, c, i;
+    unsigned long s, slot, in_bytes, out_bytes, flipped = 0, n;
+    unsigned tx, ty, f, fl, found;
+    unsigned char t[TILE_BYTES], v[TILE_BYTES];
+    unsigned short * m;
+    unsigned fb_w = 320, fb_h = 240, fb_bpp = 4;
+    long fb_size;
+
+    while ((c = getopt(argc, argv, "fo:s:")) != -1) {
+        switch (c) {
+        case 'f':
+            flips = 1;
+            break;
+        case 'o':
+            name = optarg;
+            break;
+        case 's':
+            if (sscanf(optarg, "%ux%ux%u", &fb_w, &fb_h, &fb_bpp) != 3)
+                usage();
+            break;
+        default:
+            usage();
+        }
+    }
+    if (name == NULL || optind == argc)
+        usage();
+    fb_size = (long)fb_w * fb_h * fb_bpp / 8;
+    if (fb_w == 0 || fb_h == 0 || (fb_bpp != 1 && fb_bpp != 2 && fb_bpp != 4 && fb_bpp != 8)
+        || fb_size > XRAM) {
+        fprintf(stderr, "tilepack: no %ux%u %u bpp framebuffer fits in XRAM\n", fb_w, fb_h, fb_bpp);
+        return 1;
+    }
+
+    initQuantise();
+    for (i = optind; i < argc; i++)
+        if (readInput(argv[i]) != 0) {
+            fprintf(stderr, "tilepack: can't read %s\n", argv[i]);
+            return 1;
+        }
+    if (nsprites == 0) {
+        fprintf(stderr, "tilepack: no sprites\n");
+        return 1;
+    }
+
+    for (c = 0; c < 256; c++)
+        swap_nibbles[c] = (c >> 4) | (c << 4 & 0xf0);
+
+    n = nsprites * TILES_X * TILES_Y;
+    for (hash_size = 64; hash_size < n * 2; hash_size *= 2)
+        ;
+    if ((hash_tab = calloc(hash_size, sizeof(hash_tab[0]))) == NULL
+        || (m = map = malloc(n * sizeof(map[0]))) == NULL) {
+        fprintf(stderr, "tilepack: out of memory\n");
+        return 1;
+    }
+
+    for (s = 0; s < nsprites; s++)
+        for (ty = 0; ty < TILES_Y; ty++)
+            for (tx = 0; tx < TILES_X; tx++) {
+                getTile(sprites + s * SPR_BYTES, tx, ty, t);
+
+                // A mirror image of a tile we have will do, the blitter flips it back
+                found = 0;
+                fl = 0;
+                for (f = 0; !found && f <= (flips ? (FLIP_X | FLIP_Y) : 0); f += FLIP_X) {
+                    flipTile(t, v, f);
+                    if (hash_tab[slot = findTile(v)]) {
+                        found = 1;
+                        fl = f;
+                    }
+                }
+
+                if (fl)
+                    flipped++;
+                if (!found) {
+                    if (ntiles == MAXTILES) {
+                        fprintf(stderr, "tilepack: more than %u unique tiles\n", MAXTILES);
+                        return 1;
+                    }
+                    slot = findTile(t);
+                    memcpy(tiles[ntiles], t, TILE_BYTES);
+                    hash_tab[slot] = ++ntiles;
+                }
+                *m++ = (hash_tab[slot] - 1) | fl;
+            }
+
+    // Little endian on disk whatever the host is
+    for (s = 0; s < n; s++) {
+        t[0] = map[s] & 0xff;
+        t[1] = map[s] >> 8;
+        memcpy(&map[s], t, 2);
+    }
+
+    if (writeFile(name, ".tiles", tiles, (size_t)ntiles * TILE_BYTES) != 0
+        || writeFile(name, ".map", map, n * sizeof(map[0])) != 0)
+        return 1;
+
+    in_bytes = nsprites * SPR_BYTES;
+    out_bytes = ntiles * TILE_BYTES + n * 2;
+    printf("%lu sprites, %lu tiles, %u unique", nsprites, n, ntiles);
+    if (flips)
+        printf(" (%lu more matched mirrored)", flipped);
+    printf("\n%lu bytes as sprites, %lu as tiles + map (%lu + %lu), ",
+        in_bytes, out_bytes, (unsigned long)ntiles * TILE_BYTES, n * 2);
+    if (out_bytes <= in_bytes)
+        printf("%lu bytes saved\n", in_bytes - out_bytes);
+    else
+        printf("%lu bytes more\n", out_bytes - in_bytes);
+    printf("XRAM beside the %ux%u %u bpp framebuffer: %ld bytes, %ld %s\n", fb_w, fb_h, fb_bpp, XRAM - fb_size,
+        labs(XRAM - fb_size - (long)out_bytes), (long)out_bytes <= XRAM - fb_size ? "left" : "short");
+
+    return 0;
+}